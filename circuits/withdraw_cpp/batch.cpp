@@ -0,0 +1,366 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <mutex>
+#include <system_error>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "calcwit.hpp"
+#include "circom.hpp"
+#include "witness_io.hpp"
+#include "batch.hpp"
+#include "lockstep.hpp"
+
+#define BATCH_PARSE_QUEUE_SIZE 64
+#define BATCH_WRITE_QUEUE_SIZE 16
+
+// Bounded multi-producer multi-consumer queue (D. Vyukov's design). Each
+// cell carries a sequence number telling producers and consumers whose turn
+// it is, so push and pop only need a compare-and-swap on their position.
+template <typename T>
+class BoundedQueue {
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  Cell *buffer;
+  size_t mask;
+  alignas(64) std::atomic<size_t> enqueuePos;
+  alignas(64) std::atomic<size_t> dequeuePos;
+
+public:
+
+  // size must be a power of two
+  BoundedQueue(size_t size) {
+    buffer = new Cell[size];
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+      buffer[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos.store(0, std::memory_order_relaxed);
+  }
+
+  ~BoundedQueue() {
+    delete [] buffer;
+  }
+
+  bool tryPush(T const &data) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell *cell = &buffer[pos & mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+      if (dif == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell->data = data;
+          cell->sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (dif < 0) {
+        return false;  // full
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool tryPop(T &data) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell *cell = &buffer[pos & mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (dif == 0) {
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          data = cell->data;
+          cell->sequence.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (dif < 0) {
+        return false;  // empty
+      } else {
+        pos = dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Blocking versions: spin briefly, then back off so that idle stages do not
+  // take cores away from the busy ones
+  void push(T const &data) {
+    for (uint spins = 0; !tryPush(data); spins++) {
+      backoff(spins);
+    }
+  }
+
+  T pop() {
+    T data;
+    for (uint spins = 0; !tryPop(data); spins++) {
+      backoff(spins);
+    }
+    return data;
+  }
+
+private:
+
+  static void backoff(uint spins) {
+    if (spins < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+};
+
+struct BatchJob {
+  std::string input;
+  std::string output;
+  CircomInputs inputs;
+  MappedFile *binInput;  //kept mapped until it is copied into the context
+  Circom_CalcWit *ctx;
+  std::string error;
+};
+
+static size_t nextPowerOfTwo(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+static bool endsWith(std::string const &s, std::string const &suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::string defaultOutput(std::string const &input, std::string const &outDir) {
+  std::string name = input;
+  if (!outDir.empty()) {
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+    name = outDir + "/" + name;
+  }
+  if (endsWith(name, ".json")) name = name.substr(0, name.size() - 5);
+  else if (endsWith(name, ".bin")) name = name.substr(0, name.size() - 4);
+  return name + ".wtns";
+}
+
+static void addJob(std::vector<BatchJob*> &jobs, std::string const &input, std::string const &output) {
+  BatchJob *job = new BatchJob;
+  job->input = input;
+  job->output = output;
+  job->binInput = NULL;
+  job->ctx = NULL;
+  jobs.push_back(job);
+}
+
+static void listJobs(std::string const &source, std::string const &outDir, std::vector<BatchJob*> &jobs) {
+  struct stat sb;
+  if (stat(source.c_str(), &sb) != 0) {
+    throw std::system_error(errno, std::generic_category(), source);
+  }
+  if (S_ISDIR(sb.st_mode)) {
+    DIR *dir = opendir(source.c_str());
+    if (dir == NULL) {
+      throw std::system_error(errno, std::generic_category(), source);
+    }
+    std::vector<std::string> names;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      std::string name(entry->d_name);
+      if (endsWith(name, ".json") || endsWith(name, ".bin")) names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (std::string const &name : names) {
+      std::string input = source + "/" + name;
+      addJob(jobs, input, defaultOutput(input, outDir.empty() ? source : outDir));
+    }
+  } else {
+    std::ifstream manifest(source);
+    std::string line;
+    while (std::getline(manifest, line)) {
+      std::istringstream fields(line);
+      std::string input, output;
+      if (!(fields >> input) || input[0] == '#') continue;
+      if (!(fields >> output)) output = defaultOutput(input, outDir);
+      addJob(jobs, input, output);
+    }
+  }
+}
+
+int runBatch(Circom_Circuit *circuit, std::string const &source, std::string const &outDir, bool lockstep, bool montgomery) {
+  std::vector<BatchJob*> jobs;
+  try {
+    listJobs(source, outDir, jobs);
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  uint nThreads = std::max(1u, std::thread::hardware_concurrency());
+  uint nParsers = std::max(1u, nThreads / 4);
+  uint nWriters = std::max(1u, nThreads / 4);
+  uint nComputers = nThreads > nParsers + nWriters ? nThreads - nParsers - nWriters : 1;
+
+  // Contexts circulate compute -> write -> free list, so there are enough
+  // for every compute thread (a whole group in lockstep mode), every queued
+  // result and every writer
+  uint nContexts = nComputers * (lockstep ? LOCKSTEP_LANES : 1) + BATCH_WRITE_QUEUE_SIZE + nWriters;
+  BoundedQueue<Circom_CalcWit*> freeContexts(nextPowerOfTwo(nContexts));
+  for (uint i = 0; i < nContexts; i++) {
+    freeContexts.push(new Circom_CalcWit(circuit));
+  }
+  // NULL marks the end of the stream for one consumer
+  BoundedQueue<BatchJob*> parsed(BATCH_PARSE_QUEUE_SIZE);
+  BoundedQueue<BatchJob*> computed(BATCH_WRITE_QUEUE_SIZE);
+
+  std::atomic<size_t> nextJob(0);
+  std::atomic<uint> activeParsers(nParsers);
+  std::atomic<uint> activeComputers(nComputers);
+  std::atomic<uint> nFailed(0);
+  std::mutex errMutex;
+
+  auto t_start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (uint t = 0; t < nParsers; t++) {
+    threads.push_back(std::thread([&]() {
+      for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+        BatchJob *job = jobs[i];
+        try {
+          MappedFile *f = new MappedFile(job->input);
+          if (isBinInput(f->data, f->size)) {
+            job->binInput = f;
+          } else {
+            std::unique_ptr<MappedFile> json(f);
+            parseJsonBuffer((const char *)f->data, f->size, job->inputs);
+          }
+        } catch (std::exception &e) {
+          job->error = e.what();
+        }
+        parsed.push(job);
+      }
+      if (--activeParsers == 0) {
+        for (uint c = 0; c < nComputers; c++) parsed.push(NULL);
+      }
+    }));
+  }
+  // Sets the parsed inputs of a job into a free context
+  auto setJobInputs = [&](BatchJob *job) {
+    job->ctx = freeContexts.pop();
+    job->ctx->runOnInputs = !lockstep;
+    try {
+      if (job->binInput != NULL) {
+        loadBinInputBuffer(job->ctx, job->binInput->data, job->binInput->size);
+      } else {
+        setInputs(job->ctx, job->inputs);
+      }
+      if (job->ctx->getRemaingInputsToBeSet()!=0) {
+        std::ostringstream errStrStream;
+        errStrStream << "Not all inputs have been set. Only " << get_main_input_signal_no()-job->ctx->getRemaingInputsToBeSet() << " out of " << get_main_input_signal_no() << "\n";
+        throw std::runtime_error(errStrStream.str() );
+      }
+    } catch (std::exception &e) {
+      job->error = e.what();
+    }
+    CircomInputs().swap(job->inputs);
+    delete job->binInput;
+    job->binInput = NULL;
+  };
+  for (uint t = 0; t < nComputers; t++) {
+    threads.push_back(std::thread([&]() {
+      BatchJob *job;
+      if (!lockstep) {
+        while ((job = parsed.pop()) != NULL) {
+          if (job->error.empty()) {
+            setJobInputs(job);
+          }
+          computed.push(job);
+        }
+      } else {
+        // groups of up to LOCKSTEP_LANES jobs, run together once all their
+        // inputs are set
+        Circom_Lockstep engine(circuit);
+        BatchJob *group[LOCKSTEP_LANES];
+        Circom_CalcWit *ctxs[LOCKSTEP_LANES];
+        std::string errors[LOCKSTEP_LANES];
+        bool more = true;
+        while (more) {
+          uint nGroup = 0, nReady = 0;
+          while (nGroup < LOCKSTEP_LANES && (more = (job = parsed.pop()) != NULL)) {
+            group[nGroup++] = job;
+            if (job->error.empty()) {
+              setJobInputs(job);
+              if (job->error.empty()) ctxs[nReady++] = job->ctx;
+            }
+          }
+          if (nReady > 0) {
+            engine.run(ctxs, nReady, errors);
+          }
+          for (uint i = 0, r = 0; i < nGroup; i++) {
+            if (group[i]->error.empty()) group[i]->error = errors[r++];
+            computed.push(group[i]);
+          }
+        }
+      }
+      if (--activeComputers == 0) {
+        for (uint w = 0; w < nWriters; w++) computed.push(NULL);
+      }
+    }));
+  }
+  for (uint t = 0; t < nWriters; t++) {
+    threads.push_back(std::thread([&]() {
+      BatchJob *job;
+      while ((job = computed.pop()) != NULL) {
+        if (job->error.empty()) {
+          try {
+            writeBinWitness(job->ctx, job->output, montgomery);
+          } catch (std::exception &e) {
+            job->error = e.what();
+          }
+        }
+        if (job->ctx != NULL) {
+          job->ctx->reset();
+          freeContexts.push(job->ctx);
+          job->ctx = NULL;
+        }
+        if (!job->error.empty()) {
+          nFailed++;
+          std::lock_guard<std::mutex> lock(errMutex);
+          std::cerr << job->input << ": " << job->error;
+          if (!endsWith(job->error, "\n")) std::cerr << std::endl;
+        }
+      }
+    }));
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+
+  auto t_end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(t_end - t_start).count();
+  size_t nOk = jobs.size() - nFailed;
+  std::cout << "Generated " << nOk << " witnesses (" << nFailed << " failed) in "
+            << std::fixed << std::setprecision(3) << seconds << " s: "
+            << std::setprecision(1) << (seconds > 0 ? nOk / seconds : 0) << " witnesses/s"
+            << " [" << nParsers << " parse, " << nComputers << (lockstep ? " lockstep" : "") << " compute, " << nWriters << " write threads]"
+            << std::endl;
+
+  Circom_CalcWit *ctx;
+  while (freeContexts.tryPop(ctx)) {
+    delete ctx;
+  }
+  for (BatchJob *job : jobs) {
+    delete job;
+  }
+  return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,31 @@
+#ifndef CIRCOM_BATCH_H
+#define CIRCOM_BATCH_H
+
+#include <string>
+
+#include "circom.hpp"
+
+// Batch mode: generates many witnesses in one process.
+//
+// source is either a directory, in which case every *.json and *.bin file in
+// it is an input, or a manifest file with one job per line:
+//
+//   <input.json|input.bin> [<output.wtns>]
+//
+// Blank lines and lines starting with '#' are ignored. Outputs default to
+// the input name with its .json or .bin extension replaced by .wtns, placed
+// in outDir when one is given.
+//
+// Jobs go through three stages, each on its own threads: JSON parsing,
+// witness computation and .wtns writing. Failed jobs are reported on
+// stderr and do not stop the batch. Returns EXIT_FAILURE if any job failed,
+// or if source cannot be read.
+//
+// With lockstep set, each compute thread runs the witnesses of up to
+// LOCKSTEP_LANES jobs together (see lockstep.hpp), which gives more
+// witnesses per second per core at the cost of per job latency.
+//
+// montgomery writes the values in Montgomery form (see writeBinWitness).
+int runBatch(Circom_Circuit *circuit, std::string const &source, std::string const &outDir, bool lockstep = false, bool montgomery = false);
+
+#endif // CIRCOM_BATCH_H
@@ -1,9 +1,14 @@
 #include <iomanip>
 #include <sstream>
 #include <assert.h>
+#include <stdexcept>
+#include <string.h>
 #include "calcwit.hpp"
+#include "tape.hpp"
 
 extern void run(Circom_CalcWit* ctx);
+extern Circom_TemplateFunction _functionTable[];
+extern Circom_TemplateFunction _functionTableParallel[];
 
 std::string int_to_hex( u64 i )
 {
@@ -14,30 +19,56 @@ std::string int_to_hex( u64 i )
   return stream.str();
 }
 
-u64 fnv1a(std::string s) {
+// The constant one signal, as Fr_str2element(.., "1", 10) leaves it;
+// built once, so that reset() does not go through gmp
+static const FrElement &oneSignal() {
+  static const FrElement one = []() {
+    FrElement e;
+    Fr_str2element(&e, "1", 10);
+    return e;
+  }();
+  return one;
+}
+
+u64 fnv1a(std::string const &s) {
   u64 hash = 0xCBF29CE484222325LL;
-  for(char& c : s) {
+  for(char const& c : s) {
     hash ^= u64(c);
     hash *= 0x100000001B3LL;
   }
   return hash;
 }
 
-Circom_CalcWit::Circom_CalcWit (Circom_Circuit *aCircuit, uint maxTh) {
+Circom_CalcWit::Circom_CalcWit (Circom_Circuit *aCircuit, uint maxTh)
+  : templateInsId2IOSignalInfo(aCircuit -> templateInsId2IOSignalInfo) {
   circuit = aCircuit;
   inputSignalAssignedCounter = get_main_input_signal_no();
   inputSignalAssigned = new bool[inputSignalAssignedCounter];
-  for (int i = 0; i< inputSignalAssignedCounter; i++) {
+  for (uint i = 0; i< inputSignalAssignedCounter; i++) {
     inputSignalAssigned[i] = false;
   }
-  signalValues = new FrElement[get_total_signal_no()];
-  Fr_str2element(&signalValues[0], "1", 10);
+  // only the witness with a compacted tape
+  signalValues = new FrElement[circuit->tape != NULL ? circuit->tape->nSignals : get_total_signal_no()];
+  if (circuit->tape != NULL && circuit->tape->compacted) {
+    witness2Signal = circuit->tape->witness2Signal.data();
+    witnessRuns = &circuit->tape->witnessRuns;
+  } else {
+    witness2Signal = circuit->witness2SignalList;
+    witnessRuns = &circuit->witnessRuns;
+  }
+  signalValues[0] = oneSignal();
   componentMemory = new Circom_Component[get_number_of_components()];
+  subcomponentArena = new u32[get_total_subcomponent_no()]();
+  subcomponentArenaUsed = 0;
   circuitConstants = circuit ->circuitConstants;
-  templateInsId2IOSignalInfo = circuit -> templateInsId2IOSignalInfo;
   busInsId2FieldInfo = circuit -> busInsId2FieldInfo;
 
   maxThread = maxTh;
+  taskPool = NULL;
+  runOnInputs = true;
+  templateFunctions = _functionTable;
+  progressive = false;
+  progress = NULL;
 
   // parallelism
   numThread = 0;
@@ -45,7 +76,55 @@ Circom_CalcWit::Circom_CalcWit (Circom_Circuit *aCircuit, uint maxTh) {
 }
 
 Circom_CalcWit::~Circom_CalcWit() {
-  // ...
+  releaseComponents();
+  delete [] subcomponentArena;
+  delete [] componentMemory;
+  delete [] signalValues;
+  delete [] inputSignalAssigned;
+  delete progress;
+}
+
+// Frees whatever component bookkeeping is still owned by this context.
+// Subcomponent arrays live in the arena and go away with it; the other
+// arrays are only created by parallel templates and a run that stopped half
+// way can leave any of them behind.
+void Circom_CalcWit::releaseComponents() {
+  uint n = get_number_of_components();
+  for (uint i = 0; i < n; i++) {
+    Circom_Component &c = componentMemory[i];
+    delete [] c.subcomponentsParallel;
+    delete [] c.outputIsSet;
+    delete [] c.mutexes;
+    delete [] c.cvs;
+    delete [] c.sbct;
+    c.subcomponents = NULL;
+    c.subcomponentsParallel = NULL;
+    c.outputIsSet = NULL;
+    c.mutexes = NULL;
+    c.cvs = NULL;
+    c.sbct = NULL;
+    c.runningSubcomponents.error = NULL;
+  }
+}
+
+// Brings the context back to the state it had right after construction,
+// keeping the signal and component buffers and the task pool. Signal values
+// are left as they are: every signal except the constant one is written
+// before it is read.
+void Circom_CalcWit::reset() {
+  releaseComponents();
+  memset(subcomponentArena, 0, subcomponentArenaUsed.load() * sizeof(u32));
+  subcomponentArenaUsed = 0;
+  inputSignalAssignedCounter = get_main_input_signal_no();
+  for (uint i = 0; i < inputSignalAssignedCounter; i++) {
+    inputSignalAssigned[i] = false;
+  }
+  changedSignals.clear();
+  if (progress != NULL) progress->started = false;
+  signalValues[0] = oneSignal();
+  runOnInputs = true;
+  progressive = false;
+  numThread = 0;
 }
 
 uint Circom_CalcWit::getInputSignalHashPosition(u64 h) {
@@ -57,60 +136,186 @@ uint Circom_CalcWit::getInputSignalHashPosition(u64 h) {
     while (pos != inipos) {
       if (circuit->InputHashMap[pos].hash == h) return pos;
       if (circuit->InputHashMap[pos].signalid == 0) {
-	fprintf(stderr, "Signal not found\n");
-	assert(false);
+	throw std::runtime_error("Signal not found\n");
       }
       pos = (pos+1)%n; 
     }
-    fprintf(stderr, "Signals not found\n");
-    assert(false);
+    throw std::runtime_error("Signals not found\n");
   }
   return pos;
 }
 
 void Circom_CalcWit::tryRunCircuit(){ 
-  if (inputSignalAssignedCounter == 0) {
-    run(this);
+  if (inputSignalAssignedCounter == 0 && runOnInputs) {
+    if (circuit->tape != NULL && progress != NULL && progress->started) {
+      circuit->tape->finish(*progress, this);
+    } else if (circuit->tape != NULL) {
+      circuit->tape->run(this);
+    } else {
+      run(this);
+    }
   }
 }
 
 void Circom_CalcWit::setInputSignal(u64 h, uint i,  FrElement & val){
   if (inputSignalAssignedCounter == 0) {
-    fprintf(stderr, "No more signals to be assigned\n");
-    assert(false);
+    throw std::runtime_error("No more signals to be assigned\n");
   }
   uint pos = getInputSignalHashPosition(h);
   if (i >= circuit->InputHashMap[pos].signalsize) {
-    fprintf(stderr, "Input signal array access exceeds the size\n");
-    assert(false);
+    throw std::runtime_error("Input signal array access exceeds the size\n");
   }
   
   uint si = circuit->InputHashMap[pos].signalid+i;
   if (inputSignalAssigned[si-get_main_input_signal_start()]) {
-    fprintf(stderr, "Signal assigned twice: %d\n", si);
-    assert(false);
+    std::ostringstream errStrStream;
+    errStrStream << "Signal assigned twice: " << si << "\n";
+    throw std::runtime_error(errStrStream.str());
   }
   signalValues[si] = val;
   inputSignalAssigned[si-get_main_input_signal_start()] = true;
   inputSignalAssignedCounter--;
+  inputSignalsSet(si, 1);
+}
+
+// Common end of the input setters, once signals [si, si+n) have values
+void Circom_CalcWit::inputSignalsSet(uint si, uint n) {
+  // the last inputs are left to tryRunCircuit, which finishes the tape
+  if (progressive && runOnInputs && circuit->tape != NULL && inputSignalAssignedCounter != 0) {
+    if (progress == NULL) progress = new Circom_TapeProgress();
+    circuit->tape->advance(*progress, this, si, n);
+  }
   tryRunCircuit();
 }
 
+void Circom_CalcWit::updateInputSignal(u64 h, uint i, FrElement &val) {
+  if (inputSignalAssignedCounter != 0) {
+    throw std::runtime_error("Inputs can only be updated once all of them are set\n");
+  }
+  uint pos = getInputSignalHashPosition(h);
+  if (i >= circuit->InputHashMap[pos].signalsize) {
+    throw std::runtime_error("Input signal array access exceeds the size\n");
+  }
+  uint si = circuit->InputHashMap[pos].signalid+i;
+  signalValues[si] = val;
+  changedSignals.push_back(si);
+}
+
+void Circom_CalcWit::recompute() {
+  if (changedSignals.empty()) return;
+  if (circuit->tape != NULL) {
+    circuit->tape->rerun(this, changedSignals);
+  } else {
+    // the templates can only start over, on fresh component bookkeeping
+    releaseComponents();
+    memset(subcomponentArena, 0, subcomponentArenaUsed.load() * sizeof(u32));
+    subcomponentArenaUsed = 0;
+    numThread = 0;
+    run(this);
+  }
+  changedSignals.clear();
+}
+
+// Called once all inputs of cIdx are set. Templates listed in
+// _functionTableParallel are handed to the task pool and the father must
+// call waitSubcomponents before reading their outputs or failing an assert;
+// it rethrows the first exception of those subcomponents.
+void Circom_CalcWit::runSubcomponent(uint father, uint cIdx) {
+  u32 templateId = componentMemory[cIdx].templateId;
+  if (taskPool != NULL && _functionTableParallel[templateId] != NULL) {
+    taskPool->submit(_functionTableParallel[templateId], cIdx, this, &componentMemory[father].runningSubcomponents);
+  } else {
+    templateFunctions[templateId](cIdx, this);
+  }
+}
+
+void Circom_CalcWit::waitSubcomponents(uint father) {
+  if (taskPool != NULL) {
+    taskPool->wait(&componentMemory[father].runningSubcomponents);
+  }
+}
+
+void Circom_CalcWit::setInputSignalByIndex(uint idx, uint i, FrElement &val) {
+  if (idx >= get_number_of_main_inputs()) {
+    throw std::runtime_error("Signal not found\n");
+  }
+  assignInputSignals(idx, i, &val, 1);
+}
+
+void Circom_CalcWit::setInputSignals(uint idx, FrElement const *values, uint n) {
+  if (idx >= get_number_of_main_inputs()) {
+    throw std::runtime_error("Signal not found\n");
+  }
+  if (n != get_main_input_defs()[idx].signalsize) {
+    throw std::runtime_error("Input signal array size does not match\n");
+  }
+  assignInputSignals(idx, 0, values, n);
+}
+
+// Common part of the positional setters, once the range is known to be
+// inside input idx
+void Circom_CalcWit::assignInputSignals(uint idx, uint first, FrElement const *values, uint n) {
+  InputSignalDef const &def = get_main_input_defs()[idx];
+  if (first + n > def.signalsize) {
+    throw std::runtime_error("Input signal array access exceeds the size\n");
+  }
+  if (inputSignalAssignedCounter < n) {
+    throw std::runtime_error("No more signals to be assigned\n");
+  }
+  uint si = def.signalid + first;
+  bool *assigned = &inputSignalAssigned[si - get_main_input_signal_start()];
+  for (uint i = 0; i < n; i++) {
+    if (assigned[i]) {
+      std::ostringstream errStrStream;
+      errStrStream << "Signal assigned twice: " << si + i << "\n";
+      throw std::runtime_error(errStrStream.str());
+    }
+  }
+  memcpy(&signalValues[si], values, n * sizeof(FrElement));
+  memset(assigned, 1, n * sizeof(bool));
+  inputSignalAssignedCounter -= n;
+  inputSignalsSet(si, n);
+}
+
+void Circom_CalcWit::setAllInputSignalsLE(const u8 *data, uint n) {
+  uint nInputs = get_main_input_signal_no();
+  if (n != nInputs) {
+    throw std::runtime_error("Number of input values does not match the circuit\n");
+  }
+  if (inputSignalAssignedCounter != nInputs) {
+    throw std::runtime_error("Some inputs have already been set\n");
+  }
+  FrElement *dst = &signalValues[get_main_input_signal_start()];
+  for (uint i = 0; i < n; i++) {
+    FrRawElement v;
+    memcpy(v, data + i*Fr_N64*8, Fr_N64*8);
+    if (!Circom_isCanonical(v)) {
+      std::ostringstream errStrStream;
+      errStrStream << "Input value " << i << " is not a canonical field element\n";
+      throw std::runtime_error(errStrStream.str());
+    }
+    Fr_fromRawNormal(&dst[i], v);
+  }
+  memset(inputSignalAssigned, 1, nInputs * sizeof(bool));
+  inputSignalAssignedCounter = 0;
+  inputSignalsSet(get_main_input_signal_start(), nInputs);
+}
+
 u64 Circom_CalcWit::getInputSignalSize(u64 h) {
   uint pos = getInputSignalHashPosition(h);
   return circuit->InputHashMap[pos].signalsize;
 }
 
 std::string Circom_CalcWit::getTrace(u64 id_cmp){
-  if (id_cmp == 0) return componentMemory[id_cmp].componentName;
+  Circom_Component &c = componentMemory[id_cmp];
+  std::string my_name = c.componentName;
+  if (c.nameDimensions != NULL) {
+    my_name += generate_position_array(c.nameDimensions, c.nameDimensionsSize, c.namePosition);
+  }
+  if (id_cmp == 0) return my_name;
   else{
-    u64 id_father = componentMemory[id_cmp].idFather;
-    std::string my_name = componentMemory[id_cmp].componentName;
-
-    return Circom_CalcWit::getTrace(id_father) + "." + my_name;
+    return Circom_CalcWit::getTrace(c.idFather) + "." + my_name;
   }
-
-
 }
 
 std::string Circom_CalcWit::generate_position_array(uint* dimensions, uint size_dimensions, uint index){
@@ -125,3 +330,62 @@ std::string Circom_CalcWit::generate_position_array(uint* dimensions, uint size_
   return positions;
 }
 
+bool Circom_isCanonical(const FrRawElement v) {
+  for (int j = Fr_N64-1; j >= 0; j--) {  // most significant limb first
+    if (v[j] != Fr_rawq[j]) return v[j] < Fr_rawq[j];
+  }
+  return false;
+}
+
+void Circom_assert(Circom_CalcWit *ctx, PFrElement a, const char *templateName, uint line, u64 id) {
+  if (Fr_isTrue(a)) return;
+  throw Circom_AssertError(Circom_assertMessage(ctx, templateName, line, id));
+}
+
+std::string Circom_assertMessage(Circom_CalcWit *ctx, const char *templateName, uint line, u64 id) {
+  return Circom_assertMessage(templateName, line, ctx->getTrace(id));
+}
+
+std::string Circom_assertMessage(const char *templateName, uint line, std::string const &trace) {
+  std::ostringstream errStrStream;
+  errStrStream << "Failed assert in template/function " << templateName << " line " << line << ". "
+    << "Followed trace of components: " << trace << "\n";
+  return errStrStream.str();
+}
+
+Circom_CalcWitPool::Circom_CalcWitPool(Circom_Circuit *aCircuit, uint preallocate, Circom_TaskPool *aTaskPool) {
+  circuit = aCircuit;
+  taskPool = aTaskPool;
+  freeList.reserve(preallocate);
+  for (uint i = 0; i < preallocate; i++) {
+    Circom_CalcWit *ctx = new Circom_CalcWit(circuit);
+    ctx->taskPool = taskPool;
+    freeList.push_back(ctx);
+  }
+}
+
+Circom_CalcWitPool::~Circom_CalcWitPool() {
+  for (Circom_CalcWit *ctx : freeList) {
+    delete ctx;
+  }
+}
+
+Circom_CalcWit *Circom_CalcWitPool::acquire() {
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!freeList.empty()) {
+      Circom_CalcWit *ctx = freeList.back();
+      freeList.pop_back();
+      return ctx;
+    }
+  }
+  Circom_CalcWit *ctx = new Circom_CalcWit(circuit);
+  ctx->taskPool = taskPool;
+  return ctx;
+}
+
+void Circom_CalcWitPool::release(Circom_CalcWit *ctx) {
+  ctx->reset();
+  std::lock_guard<std::mutex> lock(poolMutex);
+  freeList.push_back(ctx);
+}
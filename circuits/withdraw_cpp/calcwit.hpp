@@ -6,27 +6,51 @@
 #include <functional>
 #include <atomic>
 #include <memory>
+#include <vector>
+#include <stdexcept>
+#include <string>
+#include <assert.h>
 
 #include "circom.hpp"
 #include "fr.hpp"
+#include "taskpool.hpp"
 
 #define NMUTEXES 32 //512
 
-u64 fnv1a(std::string s);
+u64 fnv1a(std::string const &s);
+
+class Circom_CalcWit;
+struct Circom_TapeProgress;
+typedef void (*Circom_TemplateFunction)(uint __cIdx, Circom_CalcWit* __ctx); 
 
 class Circom_CalcWit {
 
   bool *inputSignalAssigned;
   uint inputSignalAssignedCounter;
 
+  // subcomponent index arrays of every component, carved out of one block
+  // sized for the whole circuit and released together by reset()
+  u32 *subcomponentArena;
+  std::atomic<uint> subcomponentArenaUsed;
+
   Circom_Circuit *circuit;
 
+  // witness tables of the circuit, or of its tape once compacted
+  const u64 *witness2Signal;
+  const std::vector<Circom_WitnessRun> *witnessRuns;
+
+  // inputs changed by updateInputSignal since the last run
+  std::vector<uint> changedSignals;
+
+  // state of the progressive evaluation, created by the first input
+  Circom_TapeProgress *progress;
+
 public:
 
   FrElement *signalValues;
   Circom_Component* componentMemory;
   FrElement* circuitConstants; 
-  std::map<u32,IOFieldDefPair> templateInsId2IOSignalInfo; 
+  std::map<u32,IOFieldDefPair> &templateInsId2IOSignalInfo; 
   IOFieldDefPair* busInsId2FieldInfo;
   std::string* listOfTemplateMessages; 
 
@@ -37,13 +61,47 @@ public:
 
   int maxThread;
 
+  // independent subcomponents are run here when set, inline otherwise
+  Circom_TaskPool *taskPool;
+
+  // whether setting the last input runs the circuit; off for contexts whose
+  // inputs are handed to the lockstep engine instead
+  bool runOnInputs;
+
+  // run functions of the templates: _functionTable, or the traced copy
+  // while the operation tape is recorded
+  Circom_TemplateFunction const *templateFunctions;
+
+  // Progressive evaluation: with an operation tape, every input set runs
+  // what can be computed from the inputs given so far, instead of waiting
+  // for the last one. An assert can then fail, and throw, from any setter.
+  bool progressive;
+
   // Functions called by the circuit
   Circom_CalcWit(Circom_Circuit *aCircuit, uint numTh = NMUTEXES);
   ~Circom_CalcWit();
 
   // Public functions
+  void reset();
   void setInputSignal(u64 h, uint i, FrElement &val);
+  // Positional versions: idx is the position of the input in
+  // get_main_input_defs(), found with get_main_input_index(h)
+  void setInputSignalByIndex(uint idx, uint i, FrElement &val);
+  // Sets all n values of input idx at once; n must be its size
+  void setInputSignals(uint idx, FrElement const *values, uint n);
+  // Sets every main input at once from n8 byte little endian values in
+  // signal order, which must be below the field prime. No input may have
+  // been set before.
+  void setAllInputSignalsLE(const u8 *data, uint n);
   void tryRunCircuit();
+
+  // Incremental recomputation of a completed witness: inputs changed with
+  // updateInputSignal are taken into account by recompute(), which redoes
+  // only what depends on them when the circuit has an operation tape, and
+  // the whole circuit otherwise. Throws like the first run if an assert
+  // fails; the changes are then still pending.
+  void updateInputSignal(u64 h, uint i, FrElement &val);
+  void recompute();
   
   u64 getInputSignalSize(u64 h);
 
@@ -51,8 +109,27 @@ public:
     return inputSignalAssignedCounter;
   }
   
+  inline u32 *allocSubcomponents(uint n) {
+    uint start = subcomponentArenaUsed.fetch_add(n);
+    assert(start + n <= get_total_subcomponent_no());
+    return &subcomponentArena[start];
+  }
+
+  void runSubcomponent(uint father, uint cIdx);
+  void waitSubcomponents(uint father);
+
   inline void getWitness(uint idx, PFrElement val) {
-    Fr_copy(val, &signalValues[circuit->witness2SignalList[idx]]);
+    Fr_copy(val, &signalValues[witness2Signal[idx]]);
+  }
+
+  // Signal holding witness entry idx, read in place by the .wtns writer
+  inline FrElement *getWitnessSignal(uint idx) {
+    return &signalValues[witness2Signal[idx]];
+  }
+
+  // The same mapping as runs of consecutive signals, for the writers
+  inline const std::vector<Circom_WitnessRun> &getWitnessRuns() {
+    return *witnessRuns;
   }
 
   std::string getTrace(u64 id_cmp);
@@ -62,9 +139,49 @@ public:
 private:
   
   uint getInputSignalHashPosition(u64 h);
+  void releaseComponents();
+  void assignInputSignals(uint idx, uint first, FrElement const *values, uint n);
+  void inputSignalsSet(uint si, uint n);
 
 };
 
-typedef void (*Circom_TemplateFunction)(uint __cIdx, Circom_CalcWit* __ctx); 
+// What a failed assert of the circuit throws, told apart from errors in the
+// inputs themselves
+class Circom_AssertError : public std::runtime_error {
+public:
+  explicit Circom_AssertError(std::string const &message) : std::runtime_error(message) {}
+};
+
+// An assert of the circuit, at the given line of templateName in component
+// id: throws Circom_AssertError with circom's message if a is false, so that
+// a witness that cannot be computed fails like a bad input, without
+// stopping the process.
+void Circom_assert(Circom_CalcWit *ctx, PFrElement a, const char *templateName, uint line, u64 id);
+std::string Circom_assertMessage(Circom_CalcWit *ctx, const char *templateName, uint line, u64 id);
+// The same message for a known trace, for the code that checks the asserts
+// of the circuit without running its templates (lockstep, validation)
+std::string Circom_assertMessage(const char *templateName, uint line, std::string const &trace);
+
+// v < q, the canonical form that binary inputs must use
+bool Circom_isCanonical(const FrRawElement v);
+
+// Keeps finished contexts around so their buffers can be reused by the next
+// witness instead of being allocated again. Safe to share between threads.
+class Circom_CalcWitPool {
+
+  Circom_Circuit *circuit;
+  Circom_TaskPool *taskPool;
+  std::mutex poolMutex;
+  std::vector<Circom_CalcWit*> freeList;
+
+public:
+
+  Circom_CalcWitPool(Circom_Circuit *aCircuit, uint preallocate = 0, Circom_TaskPool *aTaskPool = NULL);
+  ~Circom_CalcWitPool();
+
+  // Returns a context in its post-construction state
+  Circom_CalcWit *acquire();
+  void release(Circom_CalcWit *ctx);
+};
 
 #endif // CIRCOM_CALCWIT_H
@@ -2,10 +2,13 @@
 #define __CIRCOM_H
 
 #include <map>
+#include <vector>
 #include <gmp.h>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <atomic>
+#include <exception>
 
 #include "fr.hpp"
 
@@ -20,10 +23,18 @@ struct __attribute__((__packed__)) HashSignalInfo {
     u64 signalsize; 
 };
 
+//only for the main inputs: one entry per input as declared in the template
+struct InputSignalDef {
+    const char *name;
+    u64 hash;  //fnv1a(name)
+    u32 signalid;
+    u32 signalsize;
+};
+
 struct IOFieldDef { 
     u32 offset;
     u32 len;
-    u32 *lengths;
+    const u32 *lengths;  //points into the circuit image
     u32 size;
     u32 busId;
 };
@@ -33,22 +44,55 @@ struct IOFieldDefPair {
     IOFieldDef* defs;
 };
 
+class Circom_Tape;
+
+// Witness entries [witness, witness + n) are the consecutive signals
+// [signal, signal + n). The witness keeps the signal order apart from the
+// signals the compiler dropped, so the list is a few long runs.
+struct Circom_WitnessRun {
+  u32 witness;
+  u32 signal;
+  u32 n;
+};
+
+// The tables point straight into the circuit image (the mapped .dat file,
+// or the copy linked into the binary), which is read only and shared by
+// every context and every process running the circuit.
 struct Circom_Circuit {
   //  const char *P;
-  HashSignalInfo* InputHashMap;
-  u64* witness2SignalList;
-  FrElement* circuitConstants;  
+  const HashSignalInfo* InputHashMap;
+  const u64* witness2SignalList;
+  std::vector<Circom_WitnessRun> witnessRuns;  //witness2SignalList as runs, in witness order
+  FrElement* circuitConstants;  //read only too (a converted copy in Montgomery only mode)
   std::map<u32,IOFieldDefPair> templateInsId2IOSignalInfo;
   IOFieldDefPair* busInsId2FieldInfo;
+  const u8 *image;
+  size_t imageSize;
+  Circom_Tape *tape;  //replayed instead of running the templates when set
 };
 
 
+// Tasks of the task pool waited for together: how many are still running,
+// and the first exception one of them threw, rethrown by the wait
+struct Circom_TaskGroup {
+  std::atomic<u32> pending;
+  std::exception_ptr error;
+
+  Circom_TaskGroup() : pending(0) {}
+};
+
 struct Circom_Component {
   u32 templateId;
   u64 signalStart;
-  u32 inputCounter;
-  std::string templateName;
-  std::string componentName;
+  std::atomic<u32> inputCounter;  //subcomponents may feed it from several threads
+  Circom_TaskGroup runningSubcomponents;  //subcomponents handed to the task pool
+  // names are string literals from the generated code, so creating a
+  // component does not allocate; the full name is only rebuilt by getTrace
+  const char *templateName;
+  const char *componentName;
+  u32 *nameDimensions = NULL;  //set for components declared as arrays
+  u32 nameDimensionsSize = 0;
+  u32 namePosition = 0;
   u64 idFather; 
   u32* subcomponents = NULL;
   bool* subcomponentsParallel = NULL;
@@ -56,6 +100,12 @@ struct Circom_Component {
   std::mutex *mutexes = NULL;  //one for each output
   std::condition_variable *cvs = NULL;
   std::thread *sbct = NULL;//subcomponent threads
+
+  inline void setNamePosition(u32 *dimensions, u32 size, u32 position) {
+    nameDimensions = dimensions;
+    nameDimensionsSize = size;
+    namePosition = position;
+  }
 };
 
 /*
@@ -80,10 +130,19 @@ uint get_main_input_signal_start();
 uint get_main_input_signal_no();
 uint get_total_signal_no();
 uint get_number_of_components();
+uint get_total_subcomponent_no();
 uint get_size_of_input_hashmap();
+uint get_number_of_main_inputs();
+InputSignalDef const *get_main_input_defs();
+int get_main_input_index(u64 h);  //-1 if h is not the hash of a main input
 uint get_size_of_witness();
 uint get_size_of_constants();
 uint get_size_of_io_map();
 uint get_size_of_bus_field_map();
 
+// fnv1a evaluated at compile time, for input names known in advance
+constexpr u64 fnv1a_const(const char *s, u64 hash = 0xCBF29CE484222325LL) {
+  return *s == 0 ? hash : fnv1a_const(s + 1, (hash ^ u64(*s)) * 0x100000001B3LL);
+}
+
 #endif  // __CIRCOM_H
@@ -4,15 +4,93 @@
 #include <gmp.h>
 #include <assert.h>
 #include <string>
-
+#include <mutex>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#ifdef FR_GENERIC
+// defined in the data section of fr.asm otherwise
+#ifndef FR_MONTGOMERY_ONLY
+FrElement Fr_q = {0, Fr_LONG, {0x43e1f593f0000001ULL,0x2833e84879b97091ULL,0xb85045b68181585dULL,0x30644e72e131a029ULL}};
+FrElement Fr_R3 = {0, Fr_LONG, {0x5e94d8e1b4bf0040ULL,0x2a489cbe1cfbb6b8ULL,0x893cc664a19fcfedULL,0x0cf8594b7fcc657cULL}};
+#endif
+FrRawElement Fr_rawq = {0x43e1f593f0000001ULL,0x2833e84879b97091ULL,0xb85045b68181585dULL,0x30644e72e131a029ULL};
+FrRawElement Fr_rawR3 = {0x5e94d8e1b4bf0040ULL,0x2a489cbe1cfbb6b8ULL,0x893cc664a19fcfedULL,0x0cf8594b7fcc657cULL};
+#endif
+
+#if defined(__x86_64__)
+// CPUID leaf 7: BMI2 (mulx) and ADX (adcx/adox)
+static bool Fr_cpuHasADX() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+  return (ebx & bit_BMI2) && (ebx & bit_ADX);
+}
+#endif
+
+#ifdef FR_GENERIC_ADX
+// FR_NO_ADX=1 in the environment forces the portable code, for comparisons
+bool Fr_useADX = Fr_cpuHasADX() && getenv("FR_NO_ADX") == NULL;
+#elif !defined(FR_GENERIC) && defined(__x86_64__)
+// fr.asm uses mulx/adcx/adox unconditionally: stop with a clear message
+// instead of an illegal instruction on older CPUs
+static bool Fr_requireADX() {
+  if (Fr_cpuHasADX()) return true;
+  fprintf(stderr, "This CPU lacks BMI2/ADX, which fr.asm needs: build with FR_BACKEND=generic\n");
+  exit(EXIT_FAILURE);
+}
+static bool Fr_haveADX = Fr_requireADX();
+#endif
 
 static mpz_t q;
 static mpz_t zero;
 static mpz_t one;
 static mpz_t mask;
 static size_t nBits;
-static bool initialized = false;
+// q, zero, one and mask are only written once, by Fr_init, and are read only
+// afterwards, so any number of threads can use the functions below
+static std::once_flag initialized;
+
+
+#ifdef FR_MONTGOMERY_ONLY
+
+void Fr_toMpz(mpz_t r, PFrElement pE) {
+    FrRawElement tmp;
+    Fr_toRawNormal(tmp, pE);
+    mpz_import(r, Fr_N64, -1, 8, -1, 0, (const void *)tmp);
+}
+
+void Fr_fromMpz(PFrElement pE, mpz_t v) {
+    FrRawElement tmp = {0, 0, 0, 0};
+    mpz_export((void *)tmp, NULL, -1, 8, -1, 0, v);
+    Fr_fromRawNormal(pE, tmp);
+}
+
+void Fr_fromTagged(PFrElement r, const FrTaggedElement *a) {
+    FrRawElement tmp;
+    for (int j = 0; j < Fr_N64; j++) tmp[j] = a->longVal[j];
+    if (!(a->type & Fr_LONG)) {
+        FrRawElement v = {(uint64_t)(a->shortVal < 0 ? -(int64_t)a->shortVal : a->shortVal), 0, 0, 0};
+        if (a->shortVal < 0) Fr_rawNeg(tmp, v);
+        else Fr_rawCopy(tmp, v);
+        Fr_fromRawNormal(r, tmp);
+    } else if ((a->type & Fr_LONGMONTGOMERY) == Fr_LONGMONTGOMERY) {
+        Fr_fromRawMontgomery(r, tmp);
+    } else {
+        Fr_fromRawNormal(r, tmp);
+    }
+}
+
+char *Fr_element2str(PFrElement pE) {
+    mpz_t r;
+    mpz_init(r);
+    Fr_toMpz(r, pE);
+    char *res = mpz_get_str (0, 10, r);
+    mpz_clear(r);
+    return res;
+}
 
+#else
 
 void Fr_toMpz(mpz_t r, PFrElement pE) {
     FrElement tmp;
@@ -38,28 +116,10 @@ void Fr_fromMpz(PFrElement pE, mpz_t v) {
     }
 }
 
-
-bool Fr_init() {
-    if (initialized) return false;
-    initialized = true;
-    mpz_init(q);
-    mpz_import(q, Fr_N64, -1, 8, -1, 0, (const void *)Fr_q.longVal);
-    mpz_init_set_ui(zero, 0);
-    mpz_init_set_ui(one, 1);
-    nBits = mpz_sizeinbase (q, 2);
-    mpz_init(mask);
-    mpz_mul_2exp(mask, one, nBits);
-    mpz_sub(mask, mask, one);
-    return true;
+void Fr_fromTagged(PFrElement r, const FrTaggedElement *a) {
+    *r = *a;
 }
 
-void Fr_str2element(PFrElement pE, char const *s, uint base) {
-    mpz_t mr;
-    mpz_init_set_str(mr, s, base);
-    mpz_fdiv_r(mr, mr, q);
-    Fr_fromMpz(pE, mr);
-    mpz_clear(mr);
-}
 
 char *Fr_element2str(PFrElement pE) {
     FrElement tmp;
@@ -83,6 +143,32 @@ char *Fr_element2str(PFrElement pE) {
     return res;
 }
 
+#endif // FR_MONTGOMERY_ONLY
+
+bool Fr_init() {
+    bool first = false;
+    std::call_once(initialized, [&first]() {
+        mpz_init(q);
+        mpz_import(q, Fr_N64, -1, 8, -1, 0, (const void *)Fr_rawq);
+        mpz_init_set_ui(zero, 0);
+        mpz_init_set_ui(one, 1);
+        nBits = mpz_sizeinbase (q, 2);
+        mpz_init(mask);
+        mpz_mul_2exp(mask, one, nBits);
+        mpz_sub(mask, mask, one);
+        first = true;
+    });
+    return first;
+}
+
+void Fr_str2element(PFrElement pE, char const *s, uint base) {
+    mpz_t mr;
+    mpz_init_set_str(mr, s, base);
+    mpz_fdiv_r(mr, mr, q);
+    Fr_fromMpz(pE, mr);
+    mpz_clear(mr);
+}
+
 void Fr_idiv(PFrElement r, PFrElement a, PFrElement b) {
     mpz_t ma;
     mpz_t mb;
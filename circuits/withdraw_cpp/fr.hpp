@@ -14,17 +14,41 @@
 #define Fr_LONG 0x80000000
 #define Fr_LONGMONTGOMERY 0xC0000000
 typedef uint64_t FrRawElement[Fr_N64];
+
+// Tagged element: a short integer or 256 bit limbs, in normal or Montgomery
+// form. This is also how constants are stored in the .dat circuit image.
 typedef struct __attribute__((__packed__)) {
     int32_t shortVal;
     uint32_t type;
     FrRawElement longVal;
+} FrTaggedElement;
+
+#ifdef FR_MONTGOMERY_ONLY
+#ifndef FR_GENERIC
+#error "FR_MONTGOMERY_ONLY needs the generic backend (FR_BACKEND=generic)"
+#endif
+// Montgomery only mode (make ELEMENTS=montgomery): every element holds
+// x*R mod q in 32 byte aligned limbs, with no tag to dispatch on. Values
+// are converted only where they enter (inputs, constants) and leave (the
+// witness).
+typedef struct alignas(32) {
+    FrRawElement longVal;
 } FrElement;
-typedef FrElement *PFrElement;
+#else
+typedef FrTaggedElement FrElement;
 extern FrElement Fr_q;
 extern FrElement Fr_R3;
+#endif
+typedef FrElement *PFrElement;
 extern FrRawElement Fr_rawq;
 extern FrRawElement Fr_rawR3;
 
+extern "C" void Fr_fail();
+
+#ifdef FR_GENERIC
+// Header only C++ backend (make FR_BACKEND=generic), inlined into the callers
+#include "fr_generic.hpp"
+#else
 extern "C" void Fr_copy(PFrElement r, PFrElement a);
 extern "C" void Fr_copyn(PFrElement r, PFrElement a, int n);
 extern "C" void Fr_add(PFrElement r, PFrElement a, PFrElement b);
@@ -67,7 +91,60 @@ extern "C" void Fr_rawFromMontgomery(FrRawElement pRawResult, const FrRawElement
 extern "C" int Fr_rawIsEq(const FrRawElement pRawA, const FrRawElement pRawB);
 extern "C" int Fr_rawIsZero(const FrRawElement pRawB);
 
-extern "C" void Fr_fail();
+#endif // FR_GENERIC
+
+// Conversions at the edges of the computation, to and from plain limbs in
+// canonical (normal) or Montgomery form
+#ifdef FR_MONTGOMERY_ONLY
+
+static inline void Fr_fromRawNormal(PFrElement r, const FrRawElement a) {
+    Fr_rawMMul(r->longVal, a, Fr_rawR2);
+}
+
+static inline void Fr_fromRawMontgomery(PFrElement r, const FrRawElement a) {
+    Fr_rawCopy(r->longVal, a);
+}
+
+static inline void Fr_toRawNormal(FrRawElement r, const FrElement *a) {
+    Fr_rawFromMontgomery(r, a->longVal);
+}
+
+static inline void Fr_toRawMontgomery(FrRawElement r, const FrElement *a) {
+    Fr_rawCopy(r, a->longVal);
+}
+
+#else
+
+// element wise copies: the limbs of a packed FrElement cannot be handed to
+// the raw functions by pointer
+static inline void Fr_fromRawNormal(PFrElement r, const FrRawElement a) {
+    r->shortVal = 0;
+    r->type = Fr_LONG;
+    for (int j = 0; j < Fr_N64; j++) r->longVal[j] = a[j];
+}
+
+static inline void Fr_fromRawMontgomery(PFrElement r, const FrRawElement a) {
+    r->shortVal = 0;
+    r->type = Fr_LONGMONTGOMERY;
+    for (int j = 0; j < Fr_N64; j++) r->longVal[j] = a[j];
+}
+
+static inline void Fr_toRawNormal(FrRawElement r, PFrElement a) {
+    FrElement t;
+    Fr_toLongNormal(&t, a);
+    for (int j = 0; j < Fr_N64; j++) r[j] = t.longVal[j];
+}
+
+static inline void Fr_toRawMontgomery(FrRawElement r, PFrElement a) {
+    FrElement t;
+    Fr_toMontgomery(&t, a);
+    for (int j = 0; j < Fr_N64; j++) r[j] = t.longVal[j];
+}
+
+#endif // FR_MONTGOMERY_ONLY
+
+// Stored (tagged) element, such as a circuit constant, to a working element
+void Fr_fromTagged(PFrElement r, const FrTaggedElement *a);
 
 
 // Pending functions to convert
@@ -134,6 +211,14 @@ public:
     void inline mul1(Element &r, const Element &a, uint64_t b) { Fr_rawMMul1(r.v, a.v, b); };
     void inline neg(Element &r, const Element &a) { Fr_rawNeg(r.v, a.v); };
     void inline square(Element &r, const Element &a) { Fr_rawMSquare(r.v, a.v); };
+    // Element wise over n independent elements, several per SIMD register
+    // when the CPU allows it (see fr_lanes.cpp). r may alias a or b.
+    void batchMul(Element *r, const Element *a, const Element *b, unsigned int n);
+    void batchSquare(Element *r, const Element *a, unsigned int n);
+    void batchAdd(Element *r, const Element *a, const Element *b, unsigned int n);
+    // kernel the batch functions run on: "avx512ifma", "avx2" or "scalar"
+    static const char *batchKernel();
+
     void inv(Element &r, const Element &a);
     void div(Element &r, const Element &a, const Element &b);
     void exp(Element &r, const Element &base, uint8_t* scalar, unsigned int scalarSize);
@@ -0,0 +1,1184 @@
+#ifndef __FR_GENERIC_H
+#define __FR_GENERIC_H
+
+// Portable C++ implementation of the fr.asm field API.
+//
+// Every function mirrors the control flow of its assembly counterpart
+// (short/long/Montgomery dispatch, which type word is written and when,
+// single conditional subtraction of q) so results are bit-identical.
+// Being static inline, the compiler can keep operands in registers across
+// consecutive field operations and inline them into the generated circuit.
+//
+// Included by fr.hpp when FR_GENERIC is defined; do not include directly.
+
+#include <string.h>
+
+typedef unsigned __int128 Fr_u128;
+
+static const FrRawElement Fr_rawq_g   = {0x43e1f593f0000001ULL,0x2833e84879b97091ULL,0xb85045b68181585dULL,0x30644e72e131a029ULL};
+static const FrRawElement Fr_rawHalf  = {0xa1f0fac9f8000000ULL,0x9419f4243cdcb848ULL,0xdc2822db40c0ac2eULL,0x183227397098d014ULL};
+static const FrRawElement Fr_rawR2    = {0x1bb8e645ae216da7ULL,0x53fe3ab1e35c59e3ULL,0x8c49833d53bb8085ULL,0x0216d0b17f4e44a5ULL};
+static const FrRawElement Fr_rawR3_g  = {0x5e94d8e1b4bf0040ULL,0x2a489cbe1cfbb6b8ULL,0x893cc664a19fcfedULL,0x0cf8594b7fcc657cULL};
+static const FrRawElement Fr_rawOne   = {1,0,0,0};
+static const uint64_t Fr_lboMask = 0x3fffffffffffffffULL;
+static const uint64_t Fr_np = 0xc2e1f593efffffffULL;
+
+#ifndef FR_MONTGOMERY_ONLY
+
+/*****************************************************************************************
+ * Type word helpers. The asm treats the first 8 bytes of an element as one
+ * qword: shortVal in the low half, type in the high half.
+ *****************************************************************************************/
+
+static inline uint64_t Fr_head(const FrElement *a) {
+    uint64_t h;
+    memcpy(&h, a, 8);
+    return h;
+}
+
+static inline void Fr_setHead(PFrElement r, uint64_t h) {
+    memcpy(r, &h, 8);
+}
+
+static inline void Fr_setType(PFrElement r, uint32_t type) {
+    r->type = type;
+}
+
+static inline uint64_t *Fr_limbs(PFrElement a) {
+    return (uint64_t *)((uint8_t *)a + 8);
+}
+
+static inline const uint64_t *Fr_limbs(const FrElement *a) {
+    return (const uint64_t *)((const uint8_t *)a + 8);
+}
+
+#define Fr_isLongH(h) ((h) & 0x8000000000000000ULL)
+#define Fr_isMontH(h) ((h) & 0x4000000000000000ULL)
+
+#endif
+
+/*****************************************************************************************
+ * Raw 256 bit arithmetic
+ *****************************************************************************************/
+
+static inline int Fr_rawGeq(const uint64_t *a, const uint64_t *b) {
+    for (int i = Fr_N64 - 1; i >= 0; i--) {
+        if (a[i] != b[i]) return a[i] > b[i];
+    }
+    return 1;
+}
+
+static inline void Fr_rawSubq(uint64_t *r) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 d = (Fr_u128)r[i] - Fr_rawq_g[i] - borrow;
+        r[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+}
+
+static inline void Fr_rawAddq(uint64_t *r) {
+    uint64_t carry = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 s = (Fr_u128)r[i] + Fr_rawq_g[i] + carry;
+        r[i] = (uint64_t)s;
+        carry = (uint64_t)(s >> 64);
+    }
+}
+
+static inline void Fr_rawCopy(FrRawElement pRawResult, const FrRawElement pRawA) {
+    pRawResult[0] = pRawA[0];
+    pRawResult[1] = pRawA[1];
+    pRawResult[2] = pRawA[2];
+    pRawResult[3] = pRawA[3];
+}
+
+static inline void Fr_rawZero(FrRawElement pRawResult) {
+    pRawResult[0] = 0;
+    pRawResult[1] = 0;
+    pRawResult[2] = 0;
+    pRawResult[3] = 0;
+}
+
+static inline void Fr_rawSwap(FrRawElement pRawResult, FrRawElement pRawA) {
+    for (int i = 0; i < Fr_N64; i++) {
+        uint64_t t = pRawResult[i];
+        pRawResult[i] = pRawA[i];
+        pRawA[i] = t;
+    }
+}
+
+static inline void Fr_rawAdd(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB) {
+    uint64_t carry = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 s = (Fr_u128)pRawA[i] + pRawB[i] + carry;
+        pRawResult[i] = (uint64_t)s;
+        carry = (uint64_t)(s >> 64);
+    }
+    if (carry || Fr_rawGeq(pRawResult, Fr_rawq_g)) Fr_rawSubq(pRawResult);
+}
+
+// rawAddLS: long + unsigned 64 bit
+static inline void Fr_rawAddLS(uint64_t *r, const uint64_t *a, uint64_t b) {
+    uint64_t carry = b;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 s = (Fr_u128)a[i] + carry;
+        r[i] = (uint64_t)s;
+        carry = (uint64_t)(s >> 64);
+    }
+    if (carry || Fr_rawGeq(r, Fr_rawq_g)) Fr_rawSubq(r);
+}
+
+static inline void Fr_rawSub(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 d = (Fr_u128)pRawA[i] - pRawB[i] - borrow;
+        pRawResult[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    if (borrow) Fr_rawAddq(pRawResult);
+}
+
+// rawSubLS: long - unsigned 64 bit
+static inline void Fr_rawSubLS(uint64_t *r, const uint64_t *a, uint64_t b) {
+    uint64_t borrow = b;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 d = (Fr_u128)a[i] - borrow;
+        r[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    if (borrow) Fr_rawAddq(r);
+}
+
+// rawSubSL: unsigned 64 bit - long
+static inline void Fr_rawSubSL(uint64_t *r, uint64_t a, const uint64_t *b) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 d = (Fr_u128)(i == 0 ? a : 0) - b[i] - borrow;
+        r[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    if (borrow) Fr_rawAddq(r);
+}
+
+// rawNegLS: q - b - a, where a is long and b an unsigned 64 bit
+static inline void Fr_rawNegLS(uint64_t *r, const uint64_t *a, uint64_t b) {
+    uint64_t borrow = b;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 d = (Fr_u128)Fr_rawq_g[i] - a[i] - borrow;
+        r[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    if (borrow) Fr_rawAddq(r);
+}
+
+static inline void Fr_rawNeg(FrRawElement pRawResult, const FrRawElement pRawA) {
+    if ((pRawA[0] | pRawA[1] | pRawA[2] | pRawA[3]) == 0) {
+        Fr_rawZero(pRawResult);
+        return;
+    }
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 d = (Fr_u128)Fr_rawq_g[i] - pRawA[i] - borrow;
+        pRawResult[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+}
+
+// Montgomery reduction step shared by the multiplications (CIOS).
+static inline void Fr_rawMReduce(uint64_t *t) {
+    uint64_t m = t[0] * Fr_np;
+    Fr_u128 s = (Fr_u128)m * Fr_rawq_g[0] + t[0];
+    uint64_t c = (uint64_t)(s >> 64);
+    for (int j = 1; j < Fr_N64; j++) {
+        s = (Fr_u128)m * Fr_rawq_g[j] + t[j] + c;
+        t[j-1] = (uint64_t)s;
+        c = (uint64_t)(s >> 64);
+    }
+    s = (Fr_u128)t[Fr_N64] + c;
+    t[Fr_N64-1] = (uint64_t)s;
+    t[Fr_N64] = t[Fr_N64+1] + (uint64_t)(s >> 64);
+    t[Fr_N64+1] = 0;
+}
+
+static inline void Fr_rawMFinish(FrRawElement pRawResult, uint64_t *t) {
+    if (t[Fr_N64] || Fr_rawGeq(t, Fr_rawq_g)) Fr_rawSubq(t);
+    pRawResult[0] = t[0];
+    pRawResult[1] = t[1];
+    pRawResult[2] = t[2];
+    pRawResult[3] = t[3];
+}
+
+#if defined(__x86_64__)
+#define FR_GENERIC_ADX
+
+// Set once at startup from CPUID (fr.cpp): the CPU has BMI2 and ADX
+extern bool Fr_useADX;
+
+// Montgomery multiplication with mulx/adcx/adox, the instruction sequence
+// of Fr_rawMMul in fr.asm. Two independent carry chains (CF and OF) let the
+// products and the reduction overlap.
+static inline void Fr_rawMMulADX(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB) {
+    __asm__ volatile (
+        "movabs $0xc2e1f593efffffff, %%r9\n\t"
+        "xor %%r10, %%r10\n\t"
+        // FirstLoop
+        "mov (%%rsi), %%rdx\n\t"
+        "mulx (%%rcx), %%r11, %%rax\n\t"
+        "mulx 8(%%rcx), %%r12, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "mulx 16(%%rcx), %%r13, %%rax\n\t"
+        "adcx %%r8, %%r13\n\t"
+        "mulx 24(%%rcx), %%r14, %%r8\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "mov %%r10, %%r15\n\t"
+        "adcx %%r8, %%r15\n\t"
+        // SecondLoop
+        "mov %%r9, %%rdx\n\t"
+        "mulx %%r11, %%rdx, %%rax\n\t"
+        "mulx (%%rbx), %%rax, %%r8\n\t"
+        "adcx %%r11, %%rax\n\t"
+        "mulx 8(%%rbx), %%r11, %%rax\n\t"
+        "adcx %%r8, %%r11\n\t"
+        "adox %%r12, %%r11\n\t"
+        "mulx 16(%%rbx), %%r12, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "adox %%r13, %%r12\n\t"
+        "mulx 24(%%rbx), %%r13, %%rax\n\t"
+        "adcx %%r8, %%r13\n\t"
+        "adox %%r14, %%r13\n\t"
+        "mov %%r10, %%r14\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "adox %%r15, %%r14\n\t"
+        // FirstLoop
+        "mov 8(%%rsi), %%rdx\n\t"
+        "mov %%r10, %%r15\n\t"
+        "mulx (%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r11\n\t"
+        "adox %%r8, %%r12\n\t"
+        "mulx 8(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "adox %%r8, %%r13\n\t"
+        "mulx 16(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r13\n\t"
+        "adox %%r8, %%r14\n\t"
+        "mulx 24(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "adox %%r8, %%r15\n\t"
+        "adcx %%r10, %%r15\n\t"
+        // SecondLoop
+        "mov %%r9, %%rdx\n\t"
+        "mulx %%r11, %%rdx, %%rax\n\t"
+        "mulx (%%rbx), %%rax, %%r8\n\t"
+        "adcx %%r11, %%rax\n\t"
+        "mulx 8(%%rbx), %%r11, %%rax\n\t"
+        "adcx %%r8, %%r11\n\t"
+        "adox %%r12, %%r11\n\t"
+        "mulx 16(%%rbx), %%r12, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "adox %%r13, %%r12\n\t"
+        "mulx 24(%%rbx), %%r13, %%rax\n\t"
+        "adcx %%r8, %%r13\n\t"
+        "adox %%r14, %%r13\n\t"
+        "mov %%r10, %%r14\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "adox %%r15, %%r14\n\t"
+        // FirstLoop
+        "mov 16(%%rsi), %%rdx\n\t"
+        "mov %%r10, %%r15\n\t"
+        "mulx (%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r11\n\t"
+        "adox %%r8, %%r12\n\t"
+        "mulx 8(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "adox %%r8, %%r13\n\t"
+        "mulx 16(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r13\n\t"
+        "adox %%r8, %%r14\n\t"
+        "mulx 24(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "adox %%r8, %%r15\n\t"
+        "adcx %%r10, %%r15\n\t"
+        // SecondLoop
+        "mov %%r9, %%rdx\n\t"
+        "mulx %%r11, %%rdx, %%rax\n\t"
+        "mulx (%%rbx), %%rax, %%r8\n\t"
+        "adcx %%r11, %%rax\n\t"
+        "mulx 8(%%rbx), %%r11, %%rax\n\t"
+        "adcx %%r8, %%r11\n\t"
+        "adox %%r12, %%r11\n\t"
+        "mulx 16(%%rbx), %%r12, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "adox %%r13, %%r12\n\t"
+        "mulx 24(%%rbx), %%r13, %%rax\n\t"
+        "adcx %%r8, %%r13\n\t"
+        "adox %%r14, %%r13\n\t"
+        "mov %%r10, %%r14\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "adox %%r15, %%r14\n\t"
+        // FirstLoop
+        "mov 24(%%rsi), %%rdx\n\t"
+        "mov %%r10, %%r15\n\t"
+        "mulx (%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r11\n\t"
+        "adox %%r8, %%r12\n\t"
+        "mulx 8(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "adox %%r8, %%r13\n\t"
+        "mulx 16(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r13\n\t"
+        "adox %%r8, %%r14\n\t"
+        "mulx 24(%%rcx), %%rax, %%r8\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "adox %%r8, %%r15\n\t"
+        "adcx %%r10, %%r15\n\t"
+        // SecondLoop
+        "mov %%r9, %%rdx\n\t"
+        "mulx %%r11, %%rdx, %%rax\n\t"
+        "mulx (%%rbx), %%rax, %%r8\n\t"
+        "adcx %%r11, %%rax\n\t"
+        "mulx 8(%%rbx), %%r11, %%rax\n\t"
+        "adcx %%r8, %%r11\n\t"
+        "adox %%r12, %%r11\n\t"
+        "mulx 16(%%rbx), %%r12, %%r8\n\t"
+        "adcx %%rax, %%r12\n\t"
+        "adox %%r13, %%r12\n\t"
+        "mulx 24(%%rbx), %%r13, %%rax\n\t"
+        "adcx %%r8, %%r13\n\t"
+        "adox %%r14, %%r13\n\t"
+        "mov %%r10, %%r14\n\t"
+        "adcx %%rax, %%r14\n\t"
+        "adox %%r15, %%r14\n\t"
+        //comparison
+        "cmp 24(%%rbx), %%r14\n\t"
+        "jc 2f\n\t"
+        "jnz 1f\n\t"
+        "cmp 16(%%rbx), %%r13\n\t"
+        "jc 2f\n\t"
+        "jnz 1f\n\t"
+        "cmp 8(%%rbx), %%r12\n\t"
+        "jc 2f\n\t"
+        "jnz 1f\n\t"
+        "cmp (%%rbx), %%r11\n\t"
+        "jc 2f\n\t"
+        "jnz 1f\n\t"
+        "1:\n\t"
+        "sub (%%rbx), %%r11\n\t"
+        "sbb 8(%%rbx), %%r12\n\t"
+        "sbb 16(%%rbx), %%r13\n\t"
+        "sbb 24(%%rbx), %%r14\n\t"
+        "2:\n\t"
+        "mov %%r11, (%%rdi)\n\t"
+        "mov %%r12, 8(%%rdi)\n\t"
+        "mov %%r13, 16(%%rdi)\n\t"
+        "mov %%r14, 24(%%rdi)\n\t"
+        :
+        : "D"(pRawResult), "S"(pRawA), "c"(pRawB), "b"(Fr_rawq_g)
+        : "rax", "rdx", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "cc", "memory"
+    );
+}
+#endif
+
+static inline void Fr_rawMMul(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB) {
+#ifdef FR_GENERIC_ADX
+    if (Fr_useADX) {
+        Fr_rawMMulADX(pRawResult, pRawA, pRawB);
+        return;
+    }
+#endif
+    uint64_t t[Fr_N64+2] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < Fr_N64; i++) {
+        uint64_t c = 0;
+        for (int j = 0; j < Fr_N64; j++) {
+            Fr_u128 s = (Fr_u128)pRawA[j] * pRawB[i] + t[j] + c;
+            t[j] = (uint64_t)s;
+            c = (uint64_t)(s >> 64);
+        }
+        Fr_u128 s = (Fr_u128)t[Fr_N64] + c;
+        t[Fr_N64] = (uint64_t)s;
+        t[Fr_N64+1] = (uint64_t)(s >> 64);
+        Fr_rawMReduce(t);
+    }
+    Fr_rawMFinish(pRawResult, t);
+}
+
+static inline void Fr_rawMSquare(FrRawElement pRawResult, const FrRawElement pRawA) {
+    Fr_rawMMul(pRawResult, pRawA, pRawA);
+}
+
+static inline void Fr_rawMMul1(FrRawElement pRawResult, const FrRawElement pRawA, uint64_t pRawB) {
+    uint64_t t[Fr_N64+2] = {0, 0, 0, 0, 0, 0};
+    uint64_t c = 0;
+    for (int j = 0; j < Fr_N64; j++) {
+        Fr_u128 s = (Fr_u128)pRawA[j] * pRawB + c;
+        t[j] = (uint64_t)s;
+        c = (uint64_t)(s >> 64);
+    }
+    t[Fr_N64] = c;
+    for (int i = 0; i < Fr_N64; i++) Fr_rawMReduce(t);
+    Fr_rawMFinish(pRawResult, t);
+}
+
+static inline void Fr_rawToMontgomery(FrRawElement pRawResult, const FrRawElement &pRawA) {
+    Fr_rawMMul(pRawResult, pRawA, Fr_rawR2);
+}
+
+static inline void Fr_rawFromMontgomery(FrRawElement pRawResult, const FrRawElement &pRawA) {
+    Fr_rawMMul(pRawResult, pRawA, Fr_rawOne);
+}
+
+static inline int Fr_rawIsEq(const FrRawElement pRawA, const FrRawElement pRawB) {
+    return pRawA[0] == pRawB[0] && pRawA[1] == pRawB[1] &&
+           pRawA[2] == pRawB[2] && pRawA[3] == pRawB[3];
+}
+
+static inline int Fr_rawIsZero(const FrRawElement pRawB) {
+    return (pRawB[0] | pRawB[1] | pRawB[2] | pRawB[3]) == 0;
+}
+
+static inline void Fr_rawShl(uint64_t *r, const uint64_t *a, uint64_t n) {
+    if (n == 0) { Fr_rawCopy(r, a); return; }
+    if (n >= 254) { Fr_rawZero(r); return; }
+    uint64_t t[Fr_N64];
+    uint64_t words = n >> 6, bits = n & 0x3F;
+    for (int i = Fr_N64 - 1; i >= 0; i--) {
+        int src = i - (int)words;
+        uint64_t v = src >= 0 ? a[src] << bits : 0;
+        if (bits && src > 0) v |= a[src-1] >> (64 - bits);
+        t[i] = v;
+    }
+    t[Fr_N64-1] &= Fr_lboMask;
+    if (Fr_rawGeq(t, Fr_rawq_g)) Fr_rawSubq(t);
+    Fr_rawCopy(r, t);
+}
+
+static inline void Fr_rawShr(uint64_t *r, const uint64_t *a, uint64_t n) {
+    if (n == 0) { Fr_rawCopy(r, a); return; }
+    if (n >= 254) { Fr_rawZero(r); return; }
+    uint64_t t[Fr_N64];
+    uint64_t words = n >> 6, bits = n & 0x3F;
+    for (int i = 0; i < Fr_N64; i++) {
+        uint64_t src = i + words;
+        uint64_t v = src < Fr_N64 ? a[src] >> bits : 0;
+        if (bits && src + 1 < Fr_N64) v |= a[src+1] << (64 - bits);
+        t[i] = v;
+    }
+    Fr_rawCopy(r, t);
+}
+
+// Signed view of a long normal element: values above (q-1)/2 are negative.
+static inline int Fr_rawIsNeg(const uint64_t *a) {
+    for (int i = Fr_N64 - 1; i >= 0; i--) {
+        if (a[i] != Fr_rawHalf[i]) return a[i] > Fr_rawHalf[i];
+    }
+    return 0;
+}
+
+#ifndef FR_MONTGOMERY_ONLY
+
+/*****************************************************************************************
+ * Element conversions
+ *****************************************************************************************/
+
+static inline void Fr_copy(PFrElement r, PFrElement a) {
+    memmove(r, a, sizeof(FrElement));
+}
+
+static inline void Fr_copyn(PFrElement r, PFrElement a, int n) {
+    memmove(r, a, sizeof(FrElement) * n);
+}
+
+// rawCopyS2L: 64 bit signed integer to long normal
+static inline void Fr_rawCopyS2L(PFrElement r, int64_t v) {
+    Fr_setHead(r, 0x8000000000000000ULL);
+    uint64_t *l = Fr_limbs(r);
+    if (v >= 0) {
+        l[0] = (uint64_t)v; l[1] = 0; l[2] = 0; l[3] = 0;
+    } else {
+        uint64_t carry = 0;
+        for (int i = 0; i < Fr_N64; i++) {
+            Fr_u128 s = (Fr_u128)Fr_rawq_g[i] + (i == 0 ? (uint64_t)v : ~0ULL) + carry;
+            l[i] = (uint64_t)s;
+            carry = (uint64_t)(s >> 64);
+        }
+    }
+}
+
+static inline void Fr_toMontgomery(PFrElement r, PFrElement a) {
+    uint64_t h = Fr_head(a);
+    if (Fr_isMontH(h)) {
+        Fr_copy(r, a);
+    } else if (Fr_isLongH(h)) {
+        Fr_setHead(r, h);
+        Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_rawR2);
+        Fr_setType(r, Fr_LONGMONTGOMERY);
+    } else {
+        int64_t v = (int32_t)h;
+        Fr_setHead(r, (uint64_t)v);
+        if (v < 0) {
+            Fr_rawMMul1(Fr_limbs(r), Fr_rawR2, (uint64_t)(-v));
+            Fr_rawNeg(Fr_limbs(r), Fr_limbs(r));
+        } else {
+            Fr_rawMMul1(Fr_limbs(r), Fr_rawR2, (uint64_t)v);
+        }
+        Fr_setType(r, 0x40000000);
+    }
+}
+
+static inline void Fr_toNormal(PFrElement r, PFrElement a) {
+    uint64_t h = Fr_head(a);
+    if (Fr_isMontH(h) && Fr_isLongH(h)) {
+        Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_rawOne);
+        Fr_setType(r, Fr_LONG);
+    } else {
+        Fr_copy(r, a);
+    }
+}
+
+static inline void Fr_toLongNormal(PFrElement r, PFrElement a) {
+    uint64_t h = Fr_head(a);
+    if (Fr_isLongH(h)) {
+        if (Fr_isMontH(h)) {
+            Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_rawOne);
+            Fr_setType(r, Fr_LONG);
+        } else {
+            Fr_copy(r, a);
+        }
+    } else {
+        Fr_rawCopyS2L(r, (int32_t)h);
+        Fr_setType(r, Fr_LONG);
+    }
+}
+
+/*****************************************************************************************
+ * Arithmetic
+ *****************************************************************************************/
+
+static inline void Fr_add(PFrElement r, PFrElement a, PFrElement b) {
+    uint64_t ha = Fr_head(a), hb = Fr_head(b);
+    if (!Fr_isLongH(ha) && !Fr_isLongH(hb)) {
+        int64_t s = (int64_t)(int32_t)ha + (int32_t)hb;
+        if (s == (int32_t)s) Fr_setHead(r, (uint32_t)s);
+        else Fr_rawCopyS2L(r, s);
+        return;
+    }
+    FrElement tmp;
+    if (Fr_isLongH(ha) && !Fr_isLongH(hb)) {
+        if (!Fr_isMontH(ha)) {
+            Fr_setType(r, Fr_LONG);
+            int64_t s = (int32_t)hb;
+            if (s < 0) Fr_rawSubLS(Fr_limbs(r), Fr_limbs(a), (uint64_t)(-s));
+            else Fr_rawAddLS(Fr_limbs(r), Fr_limbs(a), (uint64_t)s);
+        } else {
+            Fr_setType(r, Fr_LONGMONTGOMERY);
+            Fr_toMontgomery(&tmp, b);
+            Fr_rawAdd(Fr_limbs(r), Fr_limbs(a), Fr_limbs(&tmp));
+        }
+    } else if (!Fr_isLongH(ha)) {
+        if (!Fr_isMontH(hb)) {
+            Fr_setType(r, Fr_LONG);
+            int64_t s = (int32_t)ha;
+            if (s < 0) Fr_rawSubLS(Fr_limbs(r), Fr_limbs(b), (uint64_t)(-s));
+            else Fr_rawAddLS(Fr_limbs(r), Fr_limbs(b), (uint64_t)s);
+        } else {
+            Fr_setType(r, Fr_LONGMONTGOMERY);
+            Fr_toMontgomery(&tmp, a);
+            Fr_rawAdd(Fr_limbs(r), Fr_limbs(&tmp), Fr_limbs(b));
+        }
+    } else if (!Fr_isMontH(ha) && !Fr_isMontH(hb)) {
+        Fr_setType(r, Fr_LONG);
+        Fr_rawAdd(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+    } else if (!Fr_isMontH(ha)) {
+        Fr_setType(r, Fr_LONGMONTGOMERY);
+        Fr_toMontgomery(&tmp, a);
+        Fr_rawAdd(Fr_limbs(r), Fr_limbs(&tmp), Fr_limbs(b));
+    } else if (!Fr_isMontH(hb)) {
+        Fr_setType(r, Fr_LONGMONTGOMERY);
+        Fr_toMontgomery(&tmp, b);
+        Fr_rawAdd(Fr_limbs(r), Fr_limbs(a), Fr_limbs(&tmp));
+    } else {
+        Fr_setType(r, Fr_LONGMONTGOMERY);
+        Fr_rawAdd(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+    }
+}
+
+static inline void Fr_sub(PFrElement r, PFrElement a, PFrElement b) {
+    uint64_t ha = Fr_head(a), hb = Fr_head(b);
+    if (!Fr_isLongH(ha) && !Fr_isLongH(hb)) {
+        int64_t s = (int64_t)(int32_t)ha - (int32_t)hb;
+        if (s == (int32_t)s) Fr_setHead(r, (uint32_t)s);
+        else Fr_rawCopyS2L(r, s);
+        return;
+    }
+    FrElement tmp;
+    if (Fr_isLongH(ha) && !Fr_isLongH(hb)) {
+        if (!Fr_isMontH(ha)) {
+            Fr_setType(r, Fr_LONG);
+            int64_t s = (int32_t)hb;
+            if (s < 0) Fr_rawAddLS(Fr_limbs(r), Fr_limbs(a), (uint64_t)(-s));
+            else Fr_rawSubLS(Fr_limbs(r), Fr_limbs(a), (uint64_t)s);
+        } else {
+            Fr_setType(r, Fr_LONGMONTGOMERY);
+            Fr_toMontgomery(&tmp, b);
+            Fr_rawSub(Fr_limbs(r), Fr_limbs(a), Fr_limbs(&tmp));
+        }
+    } else if (!Fr_isLongH(ha)) {
+        if (!Fr_isMontH(hb)) {
+            Fr_setType(r, Fr_LONG);
+            int64_t s = (int32_t)ha;
+            if (s < 0) Fr_rawNegLS(Fr_limbs(r), Fr_limbs(b), (uint64_t)(-s));
+            else Fr_rawSubSL(Fr_limbs(r), (uint64_t)s, Fr_limbs(b));
+        } else {
+            Fr_setType(r, Fr_LONGMONTGOMERY);
+            Fr_toMontgomery(&tmp, a);
+            Fr_rawSub(Fr_limbs(r), Fr_limbs(&tmp), Fr_limbs(b));
+        }
+    } else if (!Fr_isMontH(ha) && !Fr_isMontH(hb)) {
+        Fr_setType(r, Fr_LONG);
+        Fr_rawSub(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+    } else if (!Fr_isMontH(ha)) {
+        Fr_setType(r, Fr_LONGMONTGOMERY);
+        Fr_toMontgomery(&tmp, a);
+        Fr_rawSub(Fr_limbs(r), Fr_limbs(&tmp), Fr_limbs(b));
+    } else if (!Fr_isMontH(hb)) {
+        Fr_setType(r, Fr_LONGMONTGOMERY);
+        Fr_toMontgomery(&tmp, b);
+        Fr_rawSub(Fr_limbs(r), Fr_limbs(a), Fr_limbs(&tmp));
+    } else {
+        Fr_setType(r, Fr_LONGMONTGOMERY);
+        Fr_rawSub(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+    }
+}
+
+static inline void Fr_neg(PFrElement r, PFrElement a) {
+    uint64_t h = Fr_head(a);
+    if (!Fr_isLongH(h)) {
+        int64_t v = -(int64_t)(int32_t)h;
+        if (v == (int32_t)v) Fr_setHead(r, (uint32_t)v);
+        else Fr_rawCopyS2L(r, v);
+        return;
+    }
+    Fr_setHead(r, h);
+    Fr_rawNeg(Fr_limbs(r), Fr_limbs(a));
+}
+
+// long * short: a*|s| (negated when s < 0), reduced once (a*s/R)
+static inline void Fr_rawMulLS(uint64_t *r, const uint64_t *a, int32_t s) {
+    if (s < 0) {
+        Fr_rawMMul1(r, a, (uint64_t)(-(int64_t)s));
+        Fr_rawNeg(r, r);
+    } else {
+        Fr_rawMMul1(r, a, (uint64_t)(int64_t)s);
+    }
+}
+
+static inline void Fr_mul(PFrElement r, PFrElement a, PFrElement b) {
+    uint64_t ha = Fr_head(a), hb = Fr_head(b);
+    if (!Fr_isLongH(ha) && !Fr_isLongH(hb)) {
+        int64_t p = (int64_t)(int32_t)ha * (int32_t)hb;
+        if (p == (int32_t)p) Fr_setHead(r, (uint32_t)p);
+        else Fr_rawCopyS2L(r, p);
+        return;
+    }
+    if (Fr_isLongH(ha) && !Fr_isLongH(hb)) {
+        if (!Fr_isMontH(ha)) {
+            if (!Fr_isMontH(hb)) {
+                Fr_setType(r, Fr_LONGMONTGOMERY);
+                Fr_rawMulLS(Fr_limbs(r), Fr_limbs(a), (int32_t)hb);
+                Fr_rawMMul(Fr_limbs(r), Fr_limbs(r), Fr_rawR3_g);
+            } else {
+                Fr_setType(r, Fr_LONG);
+                Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+            }
+        } else {
+            if (!Fr_isMontH(hb)) {
+                Fr_setType(r, Fr_LONG);
+                Fr_rawMulLS(Fr_limbs(r), Fr_limbs(a), (int32_t)hb);
+            } else {
+                Fr_setType(r, Fr_LONGMONTGOMERY);
+                Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+            }
+        }
+    } else if (!Fr_isLongH(ha)) {
+        if (!Fr_isMontH(ha)) {
+            if (!Fr_isMontH(hb)) {
+                Fr_setType(r, Fr_LONGMONTGOMERY);
+                Fr_rawMulLS(Fr_limbs(r), Fr_limbs(b), (int32_t)ha);
+                Fr_rawMMul(Fr_limbs(r), Fr_limbs(r), Fr_rawR3_g);
+            } else {
+                Fr_setType(r, Fr_LONG);
+                Fr_rawMulLS(Fr_limbs(r), Fr_limbs(b), (int32_t)ha);
+            }
+        } else {
+            if (!Fr_isMontH(hb)) {
+                Fr_setType(r, Fr_LONG);
+                Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+            } else {
+                Fr_setType(r, Fr_LONGMONTGOMERY);
+                Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+            }
+        }
+    } else if (!Fr_isMontH(ha)) {
+        if (!Fr_isMontH(hb)) {
+            Fr_setType(r, Fr_LONGMONTGOMERY);
+            Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+            Fr_rawMMul(Fr_limbs(r), Fr_limbs(r), Fr_rawR3_g);
+        } else {
+            Fr_setType(r, Fr_LONG);
+            Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+        }
+    } else {
+        if (!Fr_isMontH(hb)) {
+            Fr_setType(r, Fr_LONG);
+            Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+        } else {
+            Fr_setType(r, Fr_LONGMONTGOMERY);
+            Fr_rawMMul(Fr_limbs(r), Fr_limbs(a), Fr_limbs(b));
+        }
+    }
+}
+
+static inline void Fr_square(PFrElement r, PFrElement a) {
+    uint64_t h = Fr_head(a);
+    if (!Fr_isLongH(h)) {
+        int64_t p = (int64_t)(int32_t)h * (int32_t)h;
+        if (p == (int32_t)p) Fr_setHead(r, (uint32_t)p);
+        else Fr_rawCopyS2L(r, p);
+        return;
+    }
+    Fr_setType(r, Fr_LONGMONTGOMERY);
+    Fr_rawMSquare(Fr_limbs(r), Fr_limbs(a));
+    if (!Fr_isMontH(h)) Fr_rawMMul(Fr_limbs(r), Fr_limbs(r), Fr_rawR3_g);
+}
+
+/*****************************************************************************************
+ * Bitwise operations: operate on the canonical (long normal) representation
+ * masked to 254 bits.
+ *****************************************************************************************/
+
+static inline void Fr_toLongNormalAny(PFrElement r, PFrElement a) {
+    uint64_t h = Fr_head(a);
+    if (Fr_isLongH(h)) Fr_toNormal(r, a);
+    else Fr_toLongNormal(r, a);
+}
+
+#define FR_GENERIC_BITOP(name, op)                                              \
+static inline void name(PFrElement r, PFrElement a, PFrElement b) {            \
+    uint64_t ha = Fr_head(a), hb = Fr_head(b);                                  \
+    if (!Fr_isLongH(ha) && !Fr_isLongH(hb) &&                                   \
+        (int32_t)ha >= 0 && (int32_t)hb >= 0) {                                 \
+        Fr_setHead(r, (uint32_t)((uint32_t)ha op (uint32_t)hb));                \
+        return;                                                                 \
+    }                                                                           \
+    FrElement ta, tb;                                                           \
+    Fr_setType(r, Fr_LONG);                                                     \
+    Fr_toLongNormalAny(&tb, b);                                                 \
+    Fr_toLongNormalAny(&ta, a);                                                 \
+    uint64_t *l = Fr_limbs(r);                                                  \
+    for (int i = 0; i < Fr_N64; i++) l[i] = Fr_limbs(&ta)[i] op Fr_limbs(&tb)[i]; \
+    l[Fr_N64-1] &= Fr_lboMask;                                                  \
+    if (Fr_rawGeq(l, Fr_rawq_g)) Fr_rawSubq(l);                                 \
+}
+
+FR_GENERIC_BITOP(Fr_band, &)
+FR_GENERIC_BITOP(Fr_bor, |)
+FR_GENERIC_BITOP(Fr_bxor, ^)
+
+#undef FR_GENERIC_BITOP
+
+static inline void Fr_bnot(PFrElement r, PFrElement a) {
+    FrElement ta;
+    Fr_setType(r, Fr_LONG);
+    Fr_toLongNormalAny(&ta, a);
+    uint64_t *l = Fr_limbs(r);
+    for (int i = 0; i < Fr_N64; i++) l[i] = ~Fr_limbs(&ta)[i];
+    l[Fr_N64-1] &= Fr_lboMask;
+    if (Fr_rawGeq(l, Fr_rawq_g)) Fr_rawSubq(l);
+}
+
+static inline void Fr_doShl(PFrElement r, PFrElement a, uint64_t n) {
+    uint64_t h = Fr_head(a);
+    FrElement ta;
+    if (!Fr_isLongH(h)) {
+        int64_t v = (int32_t)h;
+        if (v == 0) { Fr_setHead(r, 0); return; }
+        if (v > 0 && n < 31) {
+            int64_t s = v << n;
+            if ((s >> 31) == 0) { Fr_setHead(r, (uint64_t)s); return; }
+        }
+        Fr_toLongNormal(&ta, a);
+    } else {
+        Fr_toNormal(&ta, a);
+    }
+    Fr_setType(r, Fr_LONG);
+    Fr_rawShl(Fr_limbs(r), Fr_limbs(&ta), n);
+}
+
+static inline void Fr_doShr(PFrElement r, PFrElement a, uint64_t n) {
+    uint64_t h = Fr_head(a);
+    FrElement ta;
+    if (!Fr_isLongH(h)) {
+        int64_t v = (int32_t)h;
+        if (v == 0) { Fr_setHead(r, 0); return; }
+        if (v > 0) {
+            if (n >= 31) { Fr_setHead(r, 0); return; }
+            Fr_setHead(r, (uint64_t)(v >> n));
+            return;
+        }
+        Fr_toLongNormal(&ta, a);
+    } else {
+        Fr_toNormal(&ta, a);
+    }
+    Fr_setType(r, Fr_LONG);
+    Fr_rawShr(Fr_limbs(r), Fr_limbs(&ta), n);
+}
+
+// Decodes a shift amount: returns 1 for a right shift, 0 for a left shift
+// and -1 when the result is zero.
+static inline int Fr_shiftAmount(PFrElement b, uint64_t *n) {
+    uint64_t h = Fr_head(b);
+    if (!Fr_isLongH(h)) {
+        int32_t v = (int32_t)h;
+        if (v >= 0) {
+            if (v >= 254) return -1;
+            *n = v;
+            return 1;
+        }
+        uint32_t nv = (uint32_t)(-(int64_t)v);
+        if (nv >= 254) return -1;
+        *n = nv;
+        return 0;
+    }
+    FrElement tb;
+    Fr_toNormal(&tb, b);
+    const uint64_t *l = Fr_limbs(&tb);
+    if (l[0] < 254 && l[1] == 0 && l[2] == 0 && l[3] == 0) {
+        *n = l[0];
+        return 1;
+    }
+    uint64_t d[Fr_N64];
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 s = (Fr_u128)Fr_rawq_g[i] - l[i] - borrow;
+        d[i] = (uint64_t)s;
+        borrow = (uint64_t)(s >> 64) & 1;
+    }
+    if (d[0] >= 254 || d[1] || d[2] || d[3]) return -1;
+    *n = d[0];
+    return 0;
+}
+
+static inline void Fr_shr(PFrElement r, PFrElement a, PFrElement b) {
+    uint64_t n;
+    int dir = Fr_shiftAmount(b, &n);
+    if (dir < 0) Fr_setHead(r, 0);
+    else if (dir) Fr_doShr(r, a, n);
+    else Fr_doShl(r, a, n);
+}
+
+static inline void Fr_shl(PFrElement r, PFrElement a, PFrElement b) {
+    uint64_t n;
+    int dir = Fr_shiftAmount(b, &n);
+    if (dir < 0) Fr_setHead(r, 0);
+    else if (dir) Fr_doShl(r, a, n);
+    else Fr_doShr(r, a, n);
+}
+
+/*****************************************************************************************
+ * Comparisons
+ *****************************************************************************************/
+
+static inline int Fr_rlt(PFrElement a, PFrElement b) {
+    uint64_t ha = Fr_head(a), hb = Fr_head(b);
+    if (!Fr_isLongH(ha) && !Fr_isLongH(hb)) return (int32_t)ha < (int32_t)hb;
+    FrElement ta, tb;
+    Fr_toLongNormalAny(&ta, a);
+    Fr_toLongNormalAny(&tb, b);
+    const uint64_t *la = Fr_limbs(&ta), *lb = Fr_limbs(&tb);
+    int na = Fr_rawIsNeg(la), nb = Fr_rawIsNeg(lb);
+    if (na != nb) return na;
+    for (int i = Fr_N64 - 1; i >= 0; i--) {
+        if (la[i] != lb[i]) return la[i] < lb[i];
+    }
+    return 0;
+}
+
+static inline int Fr_req(PFrElement a, PFrElement b) {
+    uint64_t ha = Fr_head(a), hb = Fr_head(b);
+    if (!Fr_isLongH(ha) && !Fr_isLongH(hb)) return (int32_t)ha == (int32_t)hb;
+    FrElement ta, tb;
+    PFrElement pa = a, pb = b;
+    if (Fr_isLongH(ha) && Fr_isLongH(hb)) {
+        if (Fr_isMontH(ha) != Fr_isMontH(hb)) {
+            if (Fr_isMontH(ha)) { Fr_toMontgomery(&tb, b); pb = &tb; }
+            else { Fr_toMontgomery(&ta, a); pa = &ta; }
+        }
+    } else if (Fr_isLongH(ha)) {
+        if (Fr_isMontH(ha)) Fr_toMontgomery(&tb, b);
+        else Fr_toLongNormal(&tb, b);
+        pb = &tb;
+    } else {
+        if (Fr_isMontH(hb)) Fr_toMontgomery(&ta, a);
+        else Fr_toLongNormal(&ta, a);
+        pa = &ta;
+    }
+    return Fr_rawIsEq(Fr_limbs(pa), Fr_limbs(pb));
+}
+
+static inline void Fr_lt(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_rlt(a, b));
+}
+
+static inline void Fr_gt(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_rlt(b, a));
+}
+
+static inline void Fr_eq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_req(a, b));
+}
+
+static inline void Fr_neq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_req(a, b) ^ 1);
+}
+
+static inline void Fr_geq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_rlt(a, b) ^ 1);
+}
+
+static inline void Fr_leq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_rlt(b, a) ^ 1);
+}
+
+/*****************************************************************************************
+ * Logical operations
+ *****************************************************************************************/
+
+static inline int Fr_isTrue(PFrElement pE) {
+    uint64_t h = Fr_head(pE);
+    if (!Fr_isLongH(h)) return (uint32_t)h != 0;
+    return !Fr_rawIsZero(Fr_limbs(pE));
+}
+
+static inline void Fr_land(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_isTrue(a) & Fr_isTrue(b));
+}
+
+static inline void Fr_lor(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setHead(r, Fr_isTrue(a) | Fr_isTrue(b));
+}
+
+static inline void Fr_lnot(PFrElement r, PFrElement a) {
+    Fr_setHead(r, Fr_isTrue(a) ^ 1);
+}
+
+static inline int Fr_toInt(PFrElement pE) {
+    uint64_t h = Fr_head(pE);
+    if (!Fr_isLongH(h)) return (int32_t)h;
+    FrElement tmp;
+    const uint64_t *l = Fr_limbs(pE);
+    if (Fr_isMontH(h)) {
+        Fr_toNormal(&tmp, pE);
+        l = Fr_limbs(&tmp);
+    }
+    if ((l[0] >> 31) == 0 && l[1] == 0 && l[2] == 0 && l[3] == 0) return (int)l[0];
+    uint64_t d[Fr_N64];
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 s = (Fr_u128)l[i] - Fr_rawq_g[i] - borrow;
+        d[i] = (uint64_t)s;
+        borrow = (uint64_t)(s >> 64) & 1;
+    }
+    if (!borrow || (((int64_t)d[0] >> 31) + 1) != 0) Fr_fail();
+    return (int)d[0];
+}
+
+#else // FR_MONTGOMERY_ONLY
+
+/*****************************************************************************************
+ * Montgomery only elements: plain limbs, no tags. Operations that depend on
+ * the integer value (comparisons, bitwise operations, shifts, toInt) work on
+ * the normal form, exactly as the tagged versions do with long operands.
+ *****************************************************************************************/
+
+// one in Montgomery form: R mod q
+static const FrRawElement Fr_rawOneM = {0xac96341c4ffffffbULL,0x36fc76959f60cd29ULL,0x666ea36f7879462eULL,0x0e0a77c19a07df2fULL};
+
+static inline void Fr_copy(PFrElement r, PFrElement a) {
+    memmove(r, a, sizeof(FrElement));
+}
+
+static inline void Fr_copyn(PFrElement r, PFrElement a, int n) {
+    memmove(r, a, sizeof(FrElement) * n);
+}
+
+static inline void Fr_toMontgomery(PFrElement r, PFrElement a) {
+    Fr_copy(r, a);
+}
+
+static inline void Fr_add(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_rawAdd(r->longVal, a->longVal, b->longVal);
+}
+
+static inline void Fr_sub(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_rawSub(r->longVal, a->longVal, b->longVal);
+}
+
+static inline void Fr_neg(PFrElement r, PFrElement a) {
+    Fr_rawNeg(r->longVal, a->longVal);
+}
+
+static inline void Fr_mul(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_rawMMul(r->longVal, a->longVal, b->longVal);
+}
+
+static inline void Fr_square(PFrElement r, PFrElement a) {
+    Fr_rawMSquare(r->longVal, a->longVal);
+}
+
+static inline void Fr_setBool(PFrElement r, int v) {
+    if (v) Fr_rawCopy(r->longVal, Fr_rawOneM);
+    else Fr_rawZero(r->longVal);
+}
+
+#define FR_GENERIC_BITOP(name, op)                                              \
+static inline void name(PFrElement r, PFrElement a, PFrElement b) {            \
+    FrRawElement la, lb, l;                                                     \
+    Fr_rawFromMontgomery(la, a->longVal);                                       \
+    Fr_rawFromMontgomery(lb, b->longVal);                                       \
+    for (int i = 0; i < Fr_N64; i++) l[i] = la[i] op lb[i];                     \
+    l[Fr_N64-1] &= Fr_lboMask;                                                  \
+    if (Fr_rawGeq(l, Fr_rawq_g)) Fr_rawSubq(l);                                 \
+    Fr_rawToMontgomery(r->longVal, l);                                          \
+}
+
+FR_GENERIC_BITOP(Fr_band, &)
+FR_GENERIC_BITOP(Fr_bor, |)
+FR_GENERIC_BITOP(Fr_bxor, ^)
+
+#undef FR_GENERIC_BITOP
+
+static inline void Fr_bnot(PFrElement r, PFrElement a) {
+    FrRawElement l;
+    Fr_rawFromMontgomery(l, a->longVal);
+    for (int i = 0; i < Fr_N64; i++) l[i] = ~l[i];
+    l[Fr_N64-1] &= Fr_lboMask;
+    if (Fr_rawGeq(l, Fr_rawq_g)) Fr_rawSubq(l);
+    Fr_rawToMontgomery(r->longVal, l);
+}
+
+// Decodes a shift amount: returns 1 for a right shift, 0 for a left shift
+// and -1 when the result is zero.
+static inline int Fr_shiftAmount(PFrElement b, uint64_t *n) {
+    FrRawElement l, d;
+    Fr_rawFromMontgomery(l, b->longVal);
+    if (l[0] < 254 && l[1] == 0 && l[2] == 0 && l[3] == 0) {
+        *n = l[0];
+        return 1;
+    }
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 s = (Fr_u128)Fr_rawq_g[i] - l[i] - borrow;
+        d[i] = (uint64_t)s;
+        borrow = (uint64_t)(s >> 64) & 1;
+    }
+    if (d[0] >= 254 || d[1] || d[2] || d[3]) return -1;
+    *n = d[0];
+    return 0;
+}
+
+static inline void Fr_doShift(PFrElement r, PFrElement a, uint64_t n, int right) {
+    FrRawElement l;
+    Fr_rawFromMontgomery(l, a->longVal);
+    if (right) Fr_rawShr(l, l, n);
+    else Fr_rawShl(l, l, n);
+    Fr_rawToMontgomery(r->longVal, l);
+}
+
+static inline void Fr_shr(PFrElement r, PFrElement a, PFrElement b) {
+    uint64_t n;
+    int dir = Fr_shiftAmount(b, &n);
+    if (dir < 0) Fr_rawZero(r->longVal);
+    else Fr_doShift(r, a, n, dir);
+}
+
+static inline void Fr_shl(PFrElement r, PFrElement a, PFrElement b) {
+    uint64_t n;
+    int dir = Fr_shiftAmount(b, &n);
+    if (dir < 0) Fr_rawZero(r->longVal);
+    else Fr_doShift(r, a, n, !dir);
+}
+
+static inline int Fr_rlt(PFrElement a, PFrElement b) {
+    FrRawElement la, lb;
+    Fr_rawFromMontgomery(la, a->longVal);
+    Fr_rawFromMontgomery(lb, b->longVal);
+    int na = Fr_rawIsNeg(la), nb = Fr_rawIsNeg(lb);
+    if (na != nb) return na;
+    for (int i = Fr_N64 - 1; i >= 0; i--) {
+        if (la[i] != lb[i]) return la[i] < lb[i];
+    }
+    return 0;
+}
+
+// the Montgomery form is unique, so equality needs no conversion
+static inline int Fr_req(PFrElement a, PFrElement b) {
+    return Fr_rawIsEq(a->longVal, b->longVal);
+}
+
+static inline void Fr_lt(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_rlt(a, b));
+}
+
+static inline void Fr_gt(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_rlt(b, a));
+}
+
+static inline void Fr_eq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_req(a, b));
+}
+
+static inline void Fr_neq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_req(a, b) ^ 1);
+}
+
+static inline void Fr_geq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_rlt(a, b) ^ 1);
+}
+
+static inline void Fr_leq(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_rlt(b, a) ^ 1);
+}
+
+static inline int Fr_isTrue(PFrElement pE) {
+    return !Fr_rawIsZero(pE->longVal);
+}
+
+static inline void Fr_land(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_isTrue(a) & Fr_isTrue(b));
+}
+
+static inline void Fr_lor(PFrElement r, PFrElement a, PFrElement b) {
+    Fr_setBool(r, Fr_isTrue(a) | Fr_isTrue(b));
+}
+
+static inline void Fr_lnot(PFrElement r, PFrElement a) {
+    Fr_setBool(r, Fr_isTrue(a) ^ 1);
+}
+
+static inline int Fr_toInt(PFrElement pE) {
+    FrRawElement l, d;
+    Fr_rawFromMontgomery(l, pE->longVal);
+    if ((l[0] >> 31) == 0 && l[1] == 0 && l[2] == 0 && l[3] == 0) return (int)l[0];
+    uint64_t borrow = 0;
+    for (int i = 0; i < Fr_N64; i++) {
+        Fr_u128 s = (Fr_u128)l[i] - Fr_rawq_g[i] - borrow;
+        d[i] = (uint64_t)s;
+        borrow = (uint64_t)(s >> 64) & 1;
+    }
+    if (!borrow || (((int64_t)d[0] >> 31) + 1) != 0) Fr_fail();
+    return (int)d[0];
+}
+
+#endif // FR_MONTGOMERY_ONLY
+
+#endif // __FR_GENERIC_H
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "fr.hpp"
+
+// Lane batched arithmetic for RawFr. Independent elements are processed
+// side by side, one per 64 bit SIMD lane: multiplications and additions 8
+// at a time with AVX-512 IFMA, additions 4 at a time with AVX2 (a 32 bit
+// AVX2 multiplier does not beat mulx). The kernel is picked once at startup;
+// FR_LANES=scalar|avx2 in the environment forces a lesser one.
+//
+// The IFMA multiplication works on 5 limbs of 52 bits, so its Montgomery
+// radix is R' = 2^260. Shifting the first operand left by 4 bits, which
+// still fits in 260 bits, turns that into a reduction by R = 2^256, and the
+// sum stays below 2q. After the final conditional subtraction the results
+// are the canonical values that Fr_rawMMul returns.
+
+typedef RawFr::Element Element;
+
+enum {
+  FR_LANES_SCALAR,
+  FR_LANES_AVX2,
+  FR_LANES_IFMA
+};
+
+static int detectLanesKernel() {
+#if defined(__x86_64__)
+  int best = FR_LANES_SCALAR;
+  if (__builtin_cpu_supports("avx2")) best = FR_LANES_AVX2;
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma")) best = FR_LANES_IFMA;
+  const char *forced = getenv("FR_LANES");
+  if (forced != NULL && strcmp(forced, "scalar") == 0) return FR_LANES_SCALAR;
+  if (forced != NULL && strcmp(forced, "avx2") == 0 && best >= FR_LANES_AVX2) return FR_LANES_AVX2;
+  return best;
+#else
+  return FR_LANES_SCALAR;
+#endif
+}
+
+static const int lanesKernel = detectLanesKernel();
+
+#if defined(__x86_64__)
+
+#define FR_IFMA_TARGET __attribute__((target("avx512f,avx512ifma")))
+#define FR_AVX2_TARGET __attribute__((target("avx2")))
+
+/*****************************************************************************************
+ * AVX-512 IFMA: 8 lanes, 5 limbs of 52 bits
+ *****************************************************************************************/
+
+#define FR_IFMA_LIMBS 5
+#define FR_IFMA_BITS 52
+
+static const uint64_t ifmaQ[FR_IFMA_LIMBS] = {
+  0x1f593f0000001ULL, 0x4879b9709143eULL, 0x181585d2833e8ULL, 0xa029b85045b68ULL, 0x30644e72e131ULL
+};
+static const uint64_t ifmaN0 = 0x1f593efffffffULL;  // -q^-1 mod 2^52
+
+FR_IFMA_TARGET static inline __m512i ifmaIndex() {
+  return _mm512_setr_epi64(0, 4, 8, 12, 16, 20, 24, 28);
+}
+
+// 8 consecutive elements to 52 bit limbs, limb-major
+FR_IFMA_TARGET static inline void ifmaLoad(__m512i x[FR_IFMA_LIMBS], const Element *a, bool shift4) {
+  __m512i l[Fr_N64], w[Fr_N64 + 1];
+  for (int k = 0; k < Fr_N64; k++) {
+    l[k] = _mm512_i64gather_epi64(ifmaIndex(), (const long long *)&a->v[k], 8);
+  }
+  if (shift4) {
+    w[0] = _mm512_slli_epi64(l[0], 4);
+    for (int k = 1; k < Fr_N64; k++) {
+      w[k] = _mm512_or_si512(_mm512_slli_epi64(l[k], 4), _mm512_srli_epi64(l[k - 1], 60));
+    }
+    w[Fr_N64] = _mm512_srli_epi64(l[Fr_N64 - 1], 60);
+  } else {
+    for (int k = 0; k < Fr_N64; k++) w[k] = l[k];
+    w[Fr_N64] = _mm512_setzero_si512();
+  }
+  const __m512i mask = _mm512_set1_epi64((1ULL << FR_IFMA_BITS) - 1);
+  for (int k = 0; k < FR_IFMA_LIMBS; k++) {
+    int word = k*FR_IFMA_BITS / 64, off = k*FR_IFMA_BITS % 64;
+    __m512i v = _mm512_srlv_epi64(w[word], _mm512_set1_epi64(off));
+    v = _mm512_or_si512(v, _mm512_sllv_epi64(w[word + 1], _mm512_set1_epi64(64 - off)));
+    x[k] = _mm512_and_si512(v, mask);
+  }
+}
+
+// normalized 52 bit limbs back to 8 consecutive elements
+FR_IFMA_TARGET static inline void ifmaStore(Element *r, const __m512i x[FR_IFMA_LIMBS]) {
+  __m512i l[Fr_N64];
+  for (int k = 0; k < Fr_N64; k++) l[k] = _mm512_setzero_si512();
+  for (int k = 0; k < FR_IFMA_LIMBS; k++) {
+    int word = k*FR_IFMA_BITS / 64, off = k*FR_IFMA_BITS % 64;
+    l[word] = _mm512_or_si512(l[word], _mm512_sllv_epi64(x[k], _mm512_set1_epi64(off)));
+    if (off + FR_IFMA_BITS > 64 && word + 1 < Fr_N64) {
+      l[word + 1] = _mm512_or_si512(l[word + 1], _mm512_srlv_epi64(x[k], _mm512_set1_epi64(64 - off)));
+    }
+  }
+  for (int k = 0; k < Fr_N64; k++) {
+    _mm512_i64scatter_epi64((long long *)&r->v[k], ifmaIndex(), l[k], 8);
+  }
+}
+
+// r = a*b/2^260 mod q, a < 2^260, b < q. r is normalized and below q.
+FR_IFMA_TARGET static inline void ifmaMontMul(__m512i r[FR_IFMA_LIMBS], const __m512i a[FR_IFMA_LIMBS], const __m512i b[FR_IFMA_LIMBS]) {
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i n0 = _mm512_set1_epi64(ifmaN0);
+  const __m512i mask = _mm512_set1_epi64((1ULL << FR_IFMA_BITS) - 1);
+  __m512i q[FR_IFMA_LIMBS];
+  for (int j = 0; j < FR_IFMA_LIMBS; j++) q[j] = _mm512_set1_epi64(ifmaQ[j]);
+
+  // each accumulator takes at most 4 terms below 2^52 per round
+  __m512i t[FR_IFMA_LIMBS + 1];
+  for (int j = 0; j <= FR_IFMA_LIMBS; j++) t[j] = zero;
+  for (int i = 0; i < FR_IFMA_LIMBS; i++) {
+    for (int j = 0; j < FR_IFMA_LIMBS; j++) {
+      t[j] = _mm512_madd52lo_epu64(t[j], a[i], b[j]);
+      t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], a[i], b[j]);
+    }
+    __m512i m = _mm512_madd52lo_epu64(zero, t[0], n0);
+    for (int j = 0; j < FR_IFMA_LIMBS; j++) {
+      t[j] = _mm512_madd52lo_epu64(t[j], m, q[j]);
+      t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], m, q[j]);
+    }
+    t[1] = _mm512_add_epi64(t[1], _mm512_srli_epi64(t[0], FR_IFMA_BITS));
+    for (int j = 0; j < FR_IFMA_LIMBS; j++) t[j] = t[j + 1];
+    t[FR_IFMA_LIMBS] = zero;
+  }
+  for (int j = 0; j < FR_IFMA_LIMBS - 1; j++) {
+    t[j + 1] = _mm512_add_epi64(t[j + 1], _mm512_srli_epi64(t[j], FR_IFMA_BITS));
+    t[j] = _mm512_and_si512(t[j], mask);
+  }
+  // t < 2q: subtract q unless that borrows
+  __m512i d[FR_IFMA_LIMBS], borrow = zero;
+  for (int j = 0; j < FR_IFMA_LIMBS; j++) {
+    __m512i v = _mm512_sub_epi64(_mm512_sub_epi64(t[j], q[j]), borrow);
+    borrow = _mm512_srli_epi64(v, 63);
+    d[j] = _mm512_and_si512(v, mask);
+  }
+  __mmask8 below = _mm512_test_epi64_mask(borrow, borrow);
+  for (int j = 0; j < FR_IFMA_LIMBS; j++) {
+    r[j] = _mm512_mask_blend_epi64(below, d[j], t[j]);
+  }
+}
+
+FR_IFMA_TARGET static void ifmaMul8(Element *r, const Element *a, const Element *b) {
+  __m512i x[FR_IFMA_LIMBS], y[FR_IFMA_LIMBS];
+  ifmaLoad(x, a, true);
+  ifmaLoad(y, b, false);
+  ifmaMontMul(x, x, y);
+  ifmaStore(r, x);
+}
+
+FR_IFMA_TARGET static void ifmaSquare8(Element *r, const Element *a) {
+  __m512i x[FR_IFMA_LIMBS], y[FR_IFMA_LIMBS];
+  ifmaLoad(x, a, true);
+  ifmaLoad(y, a, false);
+  ifmaMontMul(x, x, y);
+  ifmaStore(r, x);
+}
+
+FR_IFMA_TARGET static void ifmaAdd8(Element *r, const Element *a, const Element *b) {
+  const __m512i one = _mm512_set1_epi64(1);
+  __m512i s[Fr_N64], d[Fr_N64];
+  __mmask8 carry = 0, borrow = 0;
+  for (int k = 0; k < Fr_N64; k++) {
+    __m512i x = _mm512_i64gather_epi64(ifmaIndex(), (const long long *)&a->v[k], 8);
+    __m512i y = _mm512_i64gather_epi64(ifmaIndex(), (const long long *)&b->v[k], 8);
+    __m512i t = _mm512_add_epi64(x, y);
+    __mmask8 c = _mm512_cmplt_epu64_mask(t, x);
+    s[k] = _mm512_mask_add_epi64(t, carry, t, one);
+    carry = c | (carry & _mm512_cmpeq_epi64_mask(s[k], _mm512_setzero_si512()));
+  }
+  // a + b < 2q < 2^256, so there is no carry out: subtract q unless that borrows
+  for (int k = 0; k < Fr_N64; k++) {
+    __m512i qk = _mm512_set1_epi64(Fr_rawq[k]);
+    __m512i u = _mm512_sub_epi64(s[k], qk);
+    __mmask8 b1 = _mm512_cmplt_epu64_mask(s[k], qk);
+    d[k] = _mm512_mask_sub_epi64(u, borrow, u, one);
+    borrow = b1 | (borrow & _mm512_cmpeq_epi64_mask(u, _mm512_setzero_si512()));
+  }
+  for (int k = 0; k < Fr_N64; k++) {
+    _mm512_i64scatter_epi64((long long *)&r->v[k], ifmaIndex(), _mm512_mask_blend_epi64(borrow, d[k], s[k]), 8);
+  }
+}
+
+/*****************************************************************************************
+ * AVX2: 4 lanes, additions only
+ *****************************************************************************************/
+
+// 4 consecutive elements, transposed to limb-major
+FR_AVX2_TARGET static inline void avx2LoadWords(__m256i l[Fr_N64], const Element *a) {
+  __m256i r0 = _mm256_loadu_si256((const __m256i *)a[0].v);
+  __m256i r1 = _mm256_loadu_si256((const __m256i *)a[1].v);
+  __m256i r2 = _mm256_loadu_si256((const __m256i *)a[2].v);
+  __m256i r3 = _mm256_loadu_si256((const __m256i *)a[3].v);
+  __m256i t0 = _mm256_unpacklo_epi64(r0, r1);
+  __m256i t1 = _mm256_unpackhi_epi64(r0, r1);
+  __m256i t2 = _mm256_unpacklo_epi64(r2, r3);
+  __m256i t3 = _mm256_unpackhi_epi64(r2, r3);
+  l[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+  l[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+  l[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+  l[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+FR_AVX2_TARGET static inline void avx2StoreWords(Element *r, const __m256i l[Fr_N64]) {
+  __m256i t0 = _mm256_unpacklo_epi64(l[0], l[1]);
+  __m256i t1 = _mm256_unpackhi_epi64(l[0], l[1]);
+  __m256i t2 = _mm256_unpacklo_epi64(l[2], l[3]);
+  __m256i t3 = _mm256_unpackhi_epi64(l[2], l[3]);
+  _mm256_storeu_si256((__m256i *)r[0].v, _mm256_permute2x128_si256(t0, t2, 0x20));
+  _mm256_storeu_si256((__m256i *)r[1].v, _mm256_permute2x128_si256(t1, t3, 0x20));
+  _mm256_storeu_si256((__m256i *)r[2].v, _mm256_permute2x128_si256(t0, t2, 0x31));
+  _mm256_storeu_si256((__m256i *)r[3].v, _mm256_permute2x128_si256(t1, t3, 0x31));
+}
+
+// unsigned x < y, as all ones or zero
+FR_AVX2_TARGET static inline __m256i avx2Less(__m256i x, __m256i y) {
+  const __m256i sign = _mm256_set1_epi64x(0x8000000000000000ULL);
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(y, sign), _mm256_xor_si256(x, sign));
+}
+
+FR_AVX2_TARGET static void avx2Add4(Element *r, const Element *a, const Element *b) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i x[Fr_N64], y[Fr_N64], s[Fr_N64], d[Fr_N64];
+  avx2LoadWords(x, a);
+  avx2LoadWords(y, b);
+  // carries and borrows are all ones or zero, so subtracting one adds 1
+  __m256i carry = zero, borrow = zero;
+  for (int k = 0; k < Fr_N64; k++) {
+    __m256i t = _mm256_add_epi64(x[k], y[k]);
+    __m256i c = avx2Less(t, x[k]);
+    s[k] = _mm256_sub_epi64(t, carry);
+    carry = _mm256_or_si256(c, _mm256_and_si256(carry, _mm256_cmpeq_epi64(s[k], zero)));
+  }
+  // a + b < 2q < 2^256, so there is no carry out: subtract q unless that borrows
+  for (int k = 0; k < Fr_N64; k++) {
+    __m256i qk = _mm256_set1_epi64x(Fr_rawq[k]);
+    __m256i u = _mm256_sub_epi64(s[k], qk);
+    __m256i b1 = avx2Less(s[k], qk);
+    d[k] = _mm256_add_epi64(u, borrow);
+    borrow = _mm256_or_si256(b1, _mm256_and_si256(borrow, _mm256_cmpeq_epi64(u, zero)));
+  }
+  for (int k = 0; k < Fr_N64; k++) {
+    d[k] = _mm256_blendv_epi8(d[k], s[k], borrow);
+  }
+  avx2StoreWords(r, d);
+}
+
+#endif // __x86_64__
+
+/*****************************************************************************************
+ * RawFr entry points: full blocks through the kernel, the rest one by one
+ *****************************************************************************************/
+
+void RawFr::batchMul(Element *r, const Element *a, const Element *b, unsigned int n) {
+  unsigned int i = 0;
+#if defined(__x86_64__)
+  if (lanesKernel == FR_LANES_IFMA) {
+    for (; i + 8 <= n; i += 8) ifmaMul8(&r[i], &a[i], &b[i]);
+  }
+#endif
+  for (; i < n; i++) Fr_rawMMul(r[i].v, a[i].v, b[i].v);
+}
+
+void RawFr::batchSquare(Element *r, const Element *a, unsigned int n) {
+  unsigned int i = 0;
+#if defined(__x86_64__)
+  if (lanesKernel == FR_LANES_IFMA) {
+    for (; i + 8 <= n; i += 8) ifmaSquare8(&r[i], &a[i]);
+  }
+#endif
+  for (; i < n; i++) Fr_rawMSquare(r[i].v, a[i].v);
+}
+
+void RawFr::batchAdd(Element *r, const Element *a, const Element *b, unsigned int n) {
+  unsigned int i = 0;
+#if defined(__x86_64__)
+  if (lanesKernel == FR_LANES_IFMA) {
+    for (; i + 8 <= n; i += 8) ifmaAdd8(&r[i], &a[i], &b[i]);
+  } else if (lanesKernel == FR_LANES_AVX2) {
+    for (; i + 4 <= n; i += 4) avx2Add4(&r[i], &a[i], &b[i]);
+  }
+#endif
+  for (; i < n; i++) Fr_rawAdd(r[i].v, a[i].v, b[i].v);
+}
+
+const char *RawFr::batchKernel() {
+  switch (lanesKernel) {
+    case FR_LANES_IFMA: return "avx512ifma";
+    case FR_LANES_AVX2: return "avx2";
+    default: return "scalar";
+  }
+}
@@ -0,0 +1,135 @@
+#include <string.h>
+
+#include "lockstep.hpp"
+#include "tape.hpp"
+#include "withdraw_layout.hpp"
+
+Circom_Lockstep::Circom_Lockstep(Circom_Circuit *aCircuit) {
+  circuit = aCircuit;
+  // every signal is written back, which compacted contexts have no room for
+  assert(circuit->tape == NULL || !circuit->tape->compacted);
+  lanes = new RawFr::Element[(size_t)get_total_signal_no() * LOCKSTEP_LANES]();
+}
+
+Circom_Lockstep::~Circom_Lockstep() {
+  delete [] lanes;
+}
+
+static inline void copyLanes(RawFr::Element *r, const RawFr::Element *a) {
+  memcpy(r, a, LOCKSTEP_LANES * sizeof(RawFr::Element));
+}
+
+void Circom_Lockstep::runMultiMiMC7(u64 signalStart, uint nInputs) {
+  RawFr &F = RawFr::field;
+  u64 in = signalStart + 1;
+  u64 k = signalStart + nInputs + 1;
+  u64 r = signalStart + nInputs + 2;
+  u64 mims = signalStart + MULTIMIMC7_MIMS(nInputs);
+  copyLanes(signal(r), signal(k));
+  for (uint i = 0; i < nInputs; i++) {
+    u64 mim = mims + i*MIMC7_SIGNALS;
+    copyLanes(signal(mim + 1), signal(in + i));
+    copyLanes(signal(mim + 2), signal(r + i));
+    MiMC7_0_runLanes(lanes, mim);
+    F.batchAdd(signal(r + i + 1), signal(r + i), signal(in + i), LOCKSTEP_LANES);
+    F.batchAdd(signal(r + i + 1), signal(r + i + 1), signal(mim), LOCKSTEP_LANES);
+  }
+  copyLanes(signal(signalStart), signal(r + nInputs));
+}
+
+// 0 root, 1 leaf, 2..21 pathElements, 22..41 pathIndices, 42..62 hashes,
+// then the 20 MultiMiMC7(2) hashers
+void Circom_Lockstep::runMerkleTreeChecker(u64 signalStart) {
+  RawFr &F = RawFr::field;
+  u64 elements = signalStart + 2;
+  u64 indices = signalStart + 22;
+  u64 hashes = signalStart + 42;
+  u64 hashers = signalStart + 63;
+  u64 hasherSignals = MULTIMIMC7_MIMS(2) + 2*MIMC7_SIGNALS;
+  copyLanes(signal(hashes), signal(signalStart + 1));
+  for (uint i = 0; i < TREE_LEVELS; i++) {
+    u64 hasher = hashers + i*hasherSignals;
+    RawFr::Element *h = signal(hashes + i);
+    RawFr::Element *e = signal(elements + i);
+    RawFr::Element *p = signal(indices + i);
+    RawFr::Element d[LOCKSTEP_LANES];
+    // in[0] = h - p*(h - e), in[1] = e - p*(e - h)
+    for (uint w = 0; w < LOCKSTEP_LANES; w++) F.sub(d[w], h[w], e[w]);
+    F.batchMul(d, p, d, LOCKSTEP_LANES);
+    for (uint w = 0; w < LOCKSTEP_LANES; w++) F.sub(signal(hasher + 1)[w], h[w], d[w]);
+    for (uint w = 0; w < LOCKSTEP_LANES; w++) F.sub(d[w], e[w], h[w]);
+    F.batchMul(d, p, d, LOCKSTEP_LANES);
+    for (uint w = 0; w < LOCKSTEP_LANES; w++) F.sub(signal(hasher + 2)[w], e[w], d[w]);
+    Fr_toRawMontgomery(signal(hasher + 3)[0].v, &circuit->circuitConstants[CONSTANT_ZERO]);
+    for (uint w = 1; w < LOCKSTEP_LANES; w++) F.copy(signal(hasher + 3)[w], signal(hasher + 3)[0]);
+    runMultiMiMC7(hasher, 2);
+    copyLanes(signal(hashes + i + 1), signal(hasher));
+  }
+  copyLanes(signal(signalStart), signal(hashes + TREE_LEVELS));
+}
+
+void Circom_Lockstep::run(Circom_CalcWit **ctxs, uint n, std::string *errors) {
+  RawFr &F = RawFr::field;
+  uint nSignals = get_total_signal_no();
+  uint inputStart = get_main_input_signal_start();
+  uint inputEnd = inputStart + get_main_input_signal_no();
+
+  // unused lanes repeat the first witness, and are never read back
+  for (uint w = 0; w < LOCKSTEP_LANES; w++) {
+    Circom_CalcWit *ctx = ctxs[w < n ? w : 0];
+    Fr_toRawMontgomery(signal(0)[w].v, &ctx->signalValues[0]);
+    for (uint s = inputStart; s < inputEnd; s++) {
+      Fr_toRawMontgomery(signal(s)[w].v, &ctx->signalValues[s]);
+    }
+  }
+  RawFr::Element zero;
+  Fr_toRawMontgomery(zero.v, &circuit->circuitConstants[CONSTANT_ZERO]);
+
+  // nullifierHasher: MultiMiMC7(1) of the nullifier
+  copyLanes(signal(NULLIFIER_HASHER_START + 1), signal(WITHDRAW_NULLIFIER));
+  for (uint w = 0; w < LOCKSTEP_LANES; w++) F.copy(signal(NULLIFIER_HASHER_START + 2)[w], zero);
+  runMultiMiMC7(NULLIFIER_HASHER_START, 1);
+
+  // commitmentHasher: Commitment, a MultiMiMC7(2) of nullifier and secret
+  u64 commitmentHasher = COMMITMENT_START + 3;
+  copyLanes(signal(COMMITMENT_START + 1), signal(WITHDRAW_NULLIFIER));
+  copyLanes(signal(COMMITMENT_START + 2), signal(WITHDRAW_SECRET));
+  copyLanes(signal(commitmentHasher + 1), signal(COMMITMENT_START + 1));
+  copyLanes(signal(commitmentHasher + 2), signal(COMMITMENT_START + 2));
+  for (uint w = 0; w < LOCKSTEP_LANES; w++) F.copy(signal(commitmentHasher + 3)[w], zero);
+  runMultiMiMC7(commitmentHasher, 2);
+  copyLanes(signal(COMMITMENT_START), signal(commitmentHasher));
+
+  // tree: MerkleTreeChecker(20)
+  copyLanes(signal(TREE_START + 1), signal(COMMITMENT_START));
+  for (uint i = 0; i < TREE_LEVELS; i++) {
+    copyLanes(signal(TREE_START + 2 + i), signal(WITHDRAW_PATH_ELEMENTS + i));
+    copyLanes(signal(TREE_START + 22 + i), signal(WITHDRAW_PATH_INDICES + i));
+  }
+  runMerkleTreeChecker(TREE_START);
+
+  // recipient, relayer and fee squared
+  for (uint i = 0; i < 3; i++) {
+    F.batchSquare(signal(WITHDRAW_SQUARES + i), signal(WITHDRAW_RECIPIENT + i), LOCKSTEP_LANES);
+  }
+
+  bool passed[LOCKSTEP_LANES];
+  for (uint w = 0; w < n; w++) {
+    passed[w] = false;
+    errors[w].clear();
+    if (!F.eq(signal(TREE_START)[w], signal(WITHDRAW_ROOT)[w])) {
+      errors[w] = Circom_assertMessage("Withdraw", 33, "main");
+    } else if (!F.eq(signal(NULLIFIER_HASHER_START)[w], signal(WITHDRAW_NULLIFIER_HASH)[w])) {
+      errors[w] = Circom_assertMessage("Withdraw", 39, "main");
+    } else {
+      passed[w] = true;
+    }
+  }
+  // signal by signal, so the lane blocks are read in order
+  for (uint s = 0; s < nSignals; s++) {
+    const RawFr::Element *v = signal(s);
+    for (uint w = 0; w < n; w++) {
+      if (passed[w]) Fr_fromRawMontgomery(&ctxs[w]->signalValues[s], v[w].v);
+    }
+  }
+}
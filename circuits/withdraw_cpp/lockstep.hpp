@@ -0,0 +1,52 @@
+#ifndef CIRCOM_LOCKSTEP_H
+#define CIRCOM_LOCKSTEP_H
+
+#include <string>
+
+#include "circom.hpp"
+#include "calcwit.hpp"
+#include "fr.hpp"
+
+// one IFMA register of 64 bit lanes
+#define LOCKSTEP_LANES 8
+
+// Lockstep engine: evaluates the circuit for up to LOCKSTEP_LANES witnesses
+// at once. Nothing in the withdraw circuit branches on signal values, so the
+// witnesses can go through the same sequence of field operations, each one
+// applied to all lanes with the RawFr batch functions.
+//
+// Signals are stored as an array of per-signal blocks, one Montgomery form
+// element per witness: witness w of signal s is lanes[s*LOCKSTEP_LANES + w].
+// This is a hand written replacement for Withdraw_5_run and its
+// subcomponents (see withdraw.cpp for the layout it follows), meant for
+// batch runs where throughput matters more than latency.
+class Circom_Lockstep {
+
+  Circom_Circuit *circuit;
+  RawFr::Element *lanes;
+
+public:
+
+  Circom_Lockstep(Circom_Circuit *aCircuit);
+  ~Circom_Lockstep();
+
+  // ctxs[0..n) must have every input set, with runOnInputs off so that
+  // setting them did not run the circuit; n is at most LOCKSTEP_LANES.
+  // Fills the signals of every context whose witness passes the circuit
+  // asserts; errors[w] gets the message of the failed assert otherwise.
+  void run(Circom_CalcWit **ctxs, uint n, std::string *errors);
+
+private:
+
+  inline RawFr::Element *signal(u64 s) {
+    return &lanes[s * LOCKSTEP_LANES];
+  }
+
+  void runMultiMiMC7(u64 signalStart, uint nInputs);
+  void runMerkleTreeChecker(u64 signalStart);
+};
+
+// MiMC7_0_run over LOCKSTEP_LANES witnesses (mimc7.cpp)
+void MiMC7_0_runLanes(RawFr::Element *lanes, u64 signalStart);
+
+#endif // CIRCOM_LOCKSTEP_H
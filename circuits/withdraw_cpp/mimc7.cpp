@@ -0,0 +1,220 @@
+#include "circom.hpp"
+#include "calcwit.hpp"
+#include "lockstep.hpp"
+#include "tape.hpp"
+#include "validate.hpp"
+
+// Hand written replacement for the generated body of MiMC7(91), the only
+// template this circuit spends real time in. Signal layout, relative to
+// signalStart:
+//   0 out, 1 x_in, 2 k, 3..93 t2[91], 94..184 t4[91], 185..275 t6[91],
+//   276..365 t7[90]
+// Every round is computed in Montgomery form with raw field operations and
+// written straight into the signals, instead of going through tagged
+// FrElement arithmetic and field valued loop counters.
+
+#define MIMC7_NROUNDS 91
+#define MIMC7_T2 3
+#define MIMC7_T4 (MIMC7_T2 + MIMC7_NROUNDS)
+#define MIMC7_T6 (MIMC7_T4 + MIMC7_NROUNDS)
+#define MIMC7_T7 (MIMC7_T6 + MIMC7_NROUNDS)
+
+// Round constants c[0..90] of mimc.circom, already in Montgomery form
+static const FrRawElement mimc7Constants[MIMC7_NROUNDS] = {
+    {0x0000000000000000ULL,0x0000000000000000ULL,0x0000000000000000ULL,0x0000000000000000ULL},
+    {0x95fafe165a107a9eULL,0x29ef8c47a2eb3be3ULL,0x26dde66394f647daULL,0x1799d93eb9d28486ULL},
+    {0x27ebae303c99bddcULL,0xe119af85d7427660ULL,0xbaa333f0044d87f8ULL,0x0898e040b547aa62ULL},
+    {0x041776b4a1e2bbe6ULL,0x6a515a8c9faeb3cdULL,0x74920a7f4e8ce6d8ULL,0x0497b9ca90322392ULL},
+    {0x27246fd789e3b1e7ULL,0x5e7edaac7c2121d2ULL,0x7cf97bde97e62d05ULL,0x1f384c5c9ab758ceULL},
+    {0x120feb9478580452ULL,0xf9800e6a71b8a64fULL,0x5c5ed5e1121dfa1dULL,0x098640f821d635d3ULL},
+    {0x4b69d0d51056e706ULL,0x7350619bc5b97582ULL,0x166729ba0fc09da9ULL,0x1182c21d26c3bbdaULL},
+    {0x8cd8180f4e6abc48ULL,0xaef1289cdb5a5669ULL,0xd9b3621858ee487cULL,0x2d5b816c1f7e2662ULL},
+    {0x9b875e3faff5ad6dULL,0x08c70f11ea1a33b2ULL,0x866670ed10bacbc6ULL,0x1401b926b8d7e064ULL},
+    {0x8de3758d935c2e73ULL,0x2a7a2227043f82e1ULL,0xc812f968a3bc677dULL,0x25fbbc4b6c6b7493ULL},
+    {0x6ae7e5285b40e6cbULL,0xca3becb44fc394beULL,0xc4be06427f99fc41ULL,0x1f04c6b3654f070aULL},
+    {0xcc348f031a3993ecULL,0x57ed640eb9ada5f9ULL,0x8dc1616c9604fa83ULL,0x042a8aab9589f734ULL},
+    {0x535211950998db03ULL,0xb6bf6cd8560f644aULL,0xb73798d44dc55470ULL,0x28eabd13a7d96d73ULL},
+    {0x2cab9050080a6e15ULL,0x265743c7e6e26fafULL,0xd3481ac3b2a93f77ULL,0x02dd98473682c24cULL},
+    {0x7069ff0834d76ce2ULL,0xf644f93157d7164cULL,0x98a2035bf824c70bULL,0x22c5451e70422dabULL},
+    {0x848e28734a4e36a1ULL,0xcec7cc5fe8e9b767ULL,0x1ffe37f53214ff8eULL,0x2ab9711406a66772ULL},
+    {0x62b90566855702baULL,0xbb028279ad258a29ULL,0xe593b51858411f5fULL,0x27cca53a553bef87ULL},
+    {0xfc08a07324a09999ULL,0xf0de493db92e181bULL,0x5e0b6704a9a8de2aULL,0x2684cc7798b18d83ULL},
+    {0xb247af799f1169a9ULL,0xbe1a1c7d8111c9caULL,0x255ed57008cd8860ULL,0x2935307f373490c9ULL},
+    {0x5a2aceb5de72147dULL,0x1b4612b395ce2b1bULL,0x6f1db8f37d414d70ULL,0x026fe389bcf40bddULL},
+    {0x1cb7852357fb5b24ULL,0x68710614a05b3514ULL,0x7d2cd47d21b497b5ULL,0x0cd72935d321dc8bULL},
+    {0x7da123dae2452e2fULL,0x2a6d5dd37a9d7e10ULL,0xc8d13dd9701b46c6ULL,0x20a7703eb4805dfbULL},
+    {0x607df78382adf697ULL,0x35b03c7cdea2fdc6ULL,0xf4550fff773d8aa5ULL,0x218eb33983dd0949ULL},
+    {0xca9d7efed89840a3ULL,0x556a72778eec9929ULL,0x3b40c167bc28820cULL,0x0d34cab9ed909266ULL},
+    {0xa30f7e996f8b6680ULL,0xd0d06b98d694ff7dULL,0x5013ab11347c477dULL,0x137e786bcd86f11bULL},
+    {0xf0ea94d58585e6e6ULL,0x9918b68c8c9335b5ULL,0xb5c172603a4e637bULL,0x2754c7a06bd9bf66ULL},
+    {0x109bbe4a87a92576ULL,0x19d0ebad99ad5310ULL,0x2dadf66b40237dc5ULL,0x16c9d5e9dc416d4bULL},
+    {0x9d0a9e241f5e5327ULL,0x26772efeb027e7b7ULL,0x09f7863320304453ULL,0x1340308881ce8c0dULL},
+    {0x4a3fdda139509169ULL,0x991416cd26dc2feaULL,0xa4a4f5d6c64a180eULL,0x1458a55da3a3541dULL},
+    {0xb9faab5a257f5332ULL,0x78c49c781d0bb10aULL,0xb2bc234d7d70aa99ULL,0x1bdea8856759d01eULL},
+    {0x94a400d564f68845ULL,0xeb3d50891c691591ULL,0xa3b3feab376f0a43ULL,0x06652f203d73198eULL},
+    {0x89c87264567fb483ULL,0x4b2f60c311251486ULL,0x03cba0cca07705e1ULL,0x3026e28eef2814c7ULL},
+    {0xe0dfb20184a25aa5ULL,0xf385eecbf64ca745ULL,0xcf9037e52e9e5484ULL,0x1c180bc09db61af9ULL},
+    {0xb7c65f3d422a5c41ULL,0xd8e7577cb5e84dbdULL,0x0be8208b03168040ULL,0x172c7342170eb31aULL},
+    {0xbd9eea27581e1c19ULL,0x6b64613caf2ae178ULL,0xdac1ad7e7c334906ULL,0x082dcf416745a746ULL},
+    {0x2c29b54367d2f858ULL,0x22b91e766882fb6eULL,0x78a0e632da22f63eULL,0x2c79e393526a045cULL},
+    {0xfe479c589c633887ULL,0x15cd91b885092a4fULL,0xbc3d5db352d8e977ULL,0x17e06402d1feded3ULL},
+    {0x6649b3d0b11e4ad3ULL,0x66ba9af3ae954e5fULL,0x69f82fa668d4dd3bULL,0x20bc999e284a6666ULL},
+    {0x4495687da89c186fULL,0x4f51d5a8a87e6856ULL,0xaf3ef15ed04479fbULL,0x017d8dfc2eb2be87ULL},
+    {0x0ecf798072af49c9ULL,0x9c9a190301f2307dULL,0xafcf5eb65c37a483ULL,0x0d88f3c4554fb1a3ULL},
+    {0x304492a7e795b500ULL,0x5dbc37194a49e60dULL,0xa38971f04eeb0801ULL,0x292f38249aec35b5ULL},
+    {0xb1036bf4a13521daULL,0x7560d8b053a3ca0aULL,0xd876a69602a92f96ULL,0x06f119ad4f0ed501ULL},
+    {0x7708b7e69e54d3f4ULL,0x2267aba26bf9ba17ULL,0x0f1bd7b459a0904eULL,0x26103dd88a2e57e7ULL},
+    {0x8970c4e8ab8bc959ULL,0x20b109738346635fULL,0x374b115d20134b2cULL,0x25d95187bca6ee58ULL},
+    {0x2fa7ad8ba4ade834ULL,0x031c1f91d189e9cbULL,0xafc8084e19ecd05aULL,0x211778b94bb483d7ULL},
+    {0x190da57334532e6bULL,0x2a60a17f2ca4202dULL,0x7d0547fa294c9fb4ULL,0x1c544da64ceaae73ULL},
+    {0xfd37d49d19dc2f5cULL,0x2c16d0a9bfabbdbfULL,0x38e71c408adc8dbfULL,0x1e056f7a8b5a51ccULL},
+    {0x1c509ddda6f9a65fULL,0xf15e09d4fcf07c29ULL,0x526c8977257619c6ULL,0x16f70ce286adcb34ULL},
+    {0x6d2346011f94cff8ULL,0x88c3eadbc2c463a0ULL,0xce61783e2db4a6a0ULL,0x2d5dc12a792f1e74ULL},
+    {0x41242a7d96f9abe1ULL,0x2624c926cbdc87c0ULL,0x7b5fc93ee100799bULL,0x22a276a6f19e533cULL},
+    {0xe6e674ce2fef41e5ULL,0xfa9a6a9eac55d851ULL,0x5d4f98c32499df55ULL,0x1307be65554b2dc8ULL},
+    {0x1a17412540ba0140ULL,0x407f03085b55a03fULL,0xe4075dadb45354f7ULL,0x0a9a9b6027ca74b0ULL},
+    {0xa56d113b823a50beULL,0xf5163cac12f6afcaULL,0xfdb0fe1d7930a4efULL,0x2621b716894da6b4ULL},
+    {0x90949c1fafef9c03ULL,0x22fc7ae4999f3f44ULL,0x13b3e11c2bac749fULL,0x290c65af7fd1a04fULL},
+    {0xffc6e1a7f6bd79c8ULL,0x29300a58dab289b6ULL,0xed01191024a5d16aULL,0x0e63b7d7d1e5a2baULL},
+    {0xcedfdfdf99b06aa7ULL,0xf50be1a3eee8915aULL,0x973d5a5dd1317888ULL,0x2cd3c7456173bb1bULL},
+    {0x5238a266370bb8c8ULL,0xcc4f3f3c6f67d6b7ULL,0xa75b377f05647f6eULL,0x25503cd0bd5f3cf6ULL},
+    {0x29eca4c61f2252e8ULL,0xa43f2dc79d694860ULL,0xed89e72f86cb6a77ULL,0x28a59c74da67f199ULL},
+    {0x63e9e27d2c4c2d25ULL,0x5a5b8023755748e0ULL,0x8078b086349c6d1aULL,0x134e256da122612aULL},
+    {0xcfd026adabe4cc83ULL,0x0ad2f0834b3b20afULL,0xf7495fc3cf22a9f6ULL,0x1ed44e5e939a9a22ULL},
+    {0xa70000b09a6d8f6aULL,0x16b7812dfb736502ULL,0xb0f1086bcccafd30ULL,0x05ae000afd27edb7ULL},
+    {0x51398cdd6c358435ULL,0x9c3ff1857395d319ULL,0x2688ec375b99dc8cULL,0x113fb39a0d2c38faULL},
+    {0x5131e3feb5d70edfULL,0x192d1e532bdeda69ULL,0x9e86558780fdedbaULL,0x15898ad8aafef978ULL},
+    {0x326e94067d5716feULL,0xc9da1034d371f1edULL,0x512fd8c22bad188aULL,0x20c41bccc3e935d9ULL},
+    {0xb59c9a8cff0b066aULL,0xf6bcc27318165311ULL,0xb5151d4d830c521dULL,0x1d90d1aa292874c6ULL},
+    {0xac3b277342453f96ULL,0xabcb699492f2bc3dULL,0xb80d4a84894401b3ULL,0x067d4d50e7107b37ULL},
+    {0x5f84b3655ad5c495ULL,0x5eac570a9b9ad06cULL,0x2565f7d669bcb602ULL,0x15340c1119581ab8ULL},
+    {0x18ca331463d97e51ULL,0x0d698f353cd47d5cULL,0xfca7b4b702b31b40ULL,0x0b03e01318fb277aULL},
+    {0xae2709c31f7b96d9ULL,0x43c3a124f14916e9ULL,0x74fd4339ac85c1caULL,0x11733fbb1a644719ULL},
+    {0xec7352b2361cbd0cULL,0x2772ac0aac13808eULL,0x8f240611d2363071ULL,0x0db7ea15f8b9c8bbULL},
+    {0x08899a60fbcba55fULL,0x279895e299c2323eULL,0xb1de1a009821ef1fULL,0x035e45eafd37f5e3ULL},
+    {0xf222d549a6e441f0ULL,0xe37be9ab4101850eULL,0x2834597489995ff9ULL,0x0df76295d8eae4d4ULL},
+    {0xe79315bef11c60daULL,0x4a5d74349cd91eb0ULL,0x1cba2f1e41bfe6b5ULL,0x20c8645f40a26658ULL},
+    {0x7bbb5f9aa3854524ULL,0xcdfc46756aa38bbdULL,0xd465150cff7bc57dULL,0x27d50906d806ce39ULL},
+    {0x775e29ff2e0cefd1ULL,0xf903252e4f03e221ULL,0xa4736b91598aefc8ULL,0x1fb51e7b5f05518dULL},
+    {0xe1ff6fd583bbdb7bULL,0x984812f0a1a846baULL,0x75b52c0ee489619cULL,0x14607a56dec5d322ULL},
+    {0xedd269938d3b2374ULL,0xe2dce83515b56398ULL,0xaa0f8bfc8cc52aedULL,0x163ff0efbdc1a419ULL},
+    {0x4f62026f35947112ULL,0xa62d352f6bd806b4ULL,0x3ca57da2884d3a5cULL,0x070ee56aef4bca49ULL},
+    {0x60d65548166514a4ULL,0x49947a2f33815329ULL,0x4b7e565957e69f0fULL,0x0e56cfe8d0eb9e33ULL},
+    {0x1c1a826cf783d933ULL,0x1f3d9928d1c094c2ULL,0x761140e567be7da2ULL,0x23870e6600c8e588ULL},
+    {0x447b85f6e817a17bULL,0xe8e98534cf393eb9ULL,0x15f3c6b09f1d5e4bULL,0x2b21f45a70aeae9eULL},
+    {0xdbfd956489e96fd7ULL,0xbf44a3fea83a8e46ULL,0x3240623f0930ac33ULL,0x215656eae2f01202ULL},
+    {0x510c73536df21af0ULL,0x15a8eed95bbd856bULL,0x2d82c2bf02d04e97ULL,0x04a04c2d37b7e536ULL},
+    {0xb1e11939c72839dcULL,0x540bf888208ce017ULL,0x885df5bf5a83788bULL,0x2d92f09b299458b5ULL},
+    {0xc073bcf8415c9b47ULL,0xb0d1fbcafc3602c5ULL,0x66c1d6383cdd34c7ULL,0x07d8ee809bcb95d7ULL},
+    {0x0692b858ed0aaa1dULL,0x62399fb47d26253eULL,0x62999cb0c3ddc36dULL,0x069854d32af2a138ULL},
+    {0xb5a4cc0500637724ULL,0xbb35466061e26671ULL,0x809b5eca0cfba145ULL,0x09d56c059bdc3b72ULL},
+    {0xbfd8ec02fdf8c114ULL,0x0de34a9120ff6807ULL,0x699e7dbdfaa1d86fULL,0x09e2710fcb6ecf68ULL},
+    {0xadb8778382a9bf88ULL,0x3c3b081e9b437c5aULL,0x2126f0d6f5732668ULL,0x2e5e964691be2fc4ULL},
+    {0xe177daefc7719363ULL,0x09273005c4fabc15ULL,0xd966ed5aded5d264ULL,0x1fc56830f50084e7ULL},
+    {0x5e41ab9dff3e21ffULL,0xce774bcf69ec1cbcULL,0x090a5cafb93d330eULL,0x26968f396dc45410ULL}
+};
+
+void MiMC7_0_run(uint ctx_index,Circom_CalcWit* ctx){
+  FrElement *s = &ctx->signalValues[ctx->componentMemory[ctx_index].signalStart];
+  FrRawElement x, k;
+  Fr_toRawMontgomery(x, &s[1]);
+  Fr_toRawMontgomery(k, &s[2]);
+
+  FrRawElement t, t2, t4, t6, t7;
+  Fr_rawAdd(t, k, x);
+  for (uint i = 0; i < MIMC7_NROUNDS; i++) {
+    if (i > 0) {
+      Fr_rawAdd(t, k, t7);
+      Fr_rawAdd(t, t, mimc7Constants[i]);
+    }
+    Fr_rawMSquare(t2, t);
+    Fr_rawMSquare(t4, t2);
+    Fr_rawMMul(t6, t4, t2);
+    Fr_rawMMul(t7, t6, t);
+    Fr_fromRawMontgomery(&s[MIMC7_T2 + i], t2);
+    Fr_fromRawMontgomery(&s[MIMC7_T4 + i], t4);
+    Fr_fromRawMontgomery(&s[MIMC7_T6 + i], t6);
+    if (i < MIMC7_NROUNDS - 1) {
+      Fr_fromRawMontgomery(&s[MIMC7_T7 + i], t7);
+    }
+  }
+  // out = t6[90]*t + k; the last t7 is not a signal
+  Fr_rawAdd(t7, t7, k);
+  Fr_fromRawMontgomery(&s[0], t7);
+}
+
+// The same rounds with nothing stored, for validateWithdraw
+void MiMC7_0_hash(FrRawElement out, const FrRawElement x, const FrRawElement k) {
+  FrRawElement t, t2, t4, t6, t7;
+  Fr_rawAdd(t, k, x);
+  for (uint i = 0; i < MIMC7_NROUNDS; i++) {
+    if (i > 0) {
+      Fr_rawAdd(t, k, t7);
+      Fr_rawAdd(t, t, mimc7Constants[i]);
+    }
+    Fr_rawMSquare(t2, t);
+    Fr_rawMSquare(t4, t2);
+    Fr_rawMMul(t6, t4, t2);
+    Fr_rawMMul(t7, t6, t);
+  }
+  Fr_rawAdd(out, t7, k);
+}
+
+// Same rounds for LOCKSTEP_LANES witnesses, on the lane blocks of the
+// lockstep engine; signalStart is absolute
+void MiMC7_0_runLanes(RawFr::Element *lanes, u64 signalStart) {
+  RawFr &F = RawFr::field;
+  RawFr::Element *s = &lanes[signalStart * LOCKSTEP_LANES];
+  #define MIMC7_LANES(i) (&s[(i) * LOCKSTEP_LANES])
+  const RawFr::Element *x = MIMC7_LANES(1);
+  const RawFr::Element *k = MIMC7_LANES(2);
+
+  RawFr::Element t[LOCKSTEP_LANES], c[LOCKSTEP_LANES], last[LOCKSTEP_LANES];
+  const RawFr::Element *t7 = NULL;
+  F.batchAdd(t, k, x, LOCKSTEP_LANES);
+  for (uint i = 0; i < MIMC7_NROUNDS; i++) {
+    if (i > 0) {
+      for (uint w = 0; w < LOCKSTEP_LANES; w++) Fr_rawCopy(c[w].v, mimc7Constants[i]);
+      F.batchAdd(t, k, t7, LOCKSTEP_LANES);
+      F.batchAdd(t, t, c, LOCKSTEP_LANES);
+    }
+    RawFr::Element *t2 = MIMC7_LANES(MIMC7_T2 + i);
+    RawFr::Element *t4 = MIMC7_LANES(MIMC7_T4 + i);
+    RawFr::Element *t6 = MIMC7_LANES(MIMC7_T6 + i);
+    RawFr::Element *t7i = i < MIMC7_NROUNDS - 1 ? MIMC7_LANES(MIMC7_T7 + i) : last;
+    F.batchSquare(t2, t, LOCKSTEP_LANES);
+    F.batchSquare(t4, t2, LOCKSTEP_LANES);
+    F.batchMul(t6, t4, t2, LOCKSTEP_LANES);
+    F.batchMul(t7i, t6, t, LOCKSTEP_LANES);
+    t7 = t7i;
+  }
+  F.batchAdd(MIMC7_LANES(0), last, k, LOCKSTEP_LANES);
+  #undef MIMC7_LANES
+}
+
+// The same rounds as tape operations, for Circom_Tape::record
+void MiMC7_0_record(Circom_Tape *tape, u64 signalStart) {
+  #define MIMC7_SIGNAL(i) tape->signal(signalStart + (i))
+  u32 k = MIMC7_SIGNAL(2);
+  u32 t = tape->temp();
+  u32 t7 = 0;
+  tape->emit(TAPE_ADD, t, k, MIMC7_SIGNAL(1));
+  for (uint i = 0; i < MIMC7_NROUNDS; i++) {
+    if (i > 0) {
+      u32 kt7 = tape->temp();
+      t = tape->temp();
+      tape->emit(TAPE_ADD, kt7, k, t7);
+      tape->emit(TAPE_ADD, t, kt7, tape->constant(mimc7Constants[i]));
+    }
+    u32 t2 = MIMC7_SIGNAL(MIMC7_T2 + i);
+    u32 t4 = MIMC7_SIGNAL(MIMC7_T4 + i);
+    u32 t6 = MIMC7_SIGNAL(MIMC7_T6 + i);
+    t7 = i < MIMC7_NROUNDS - 1 ? MIMC7_SIGNAL(MIMC7_T7 + i) : tape->temp();
+    tape->emit(TAPE_SQUARE, t2, t);
+    tape->emit(TAPE_SQUARE, t4, t2);
+    tape->emit(TAPE_MUL, t6, t4, t2);
+    tape->emit(TAPE_MUL, t7, t6, t);
+  }
+  tape->emit(TAPE_ADD, MIMC7_SIGNAL(0), t7, k);
+  #undef MIMC7_SIGNAL
+}
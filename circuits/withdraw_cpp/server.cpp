@@ -0,0 +1,259 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <system_error>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "calcwit.hpp"
+#include "circom.hpp"
+#include "witness_io.hpp"
+#include "server.hpp"
+#include "validate.hpp"
+#include "witness_cache.hpp"
+
+// Requests larger than this cannot be a valid input for any circuit we
+// ship; the connection is dropped instead of trying to buffer them.
+#define SERVER_MAX_REQUEST_SIZE (64u << 20)
+
+static bool readFully(int fd, void *buf, size_t size) {
+  char *p = (char *)buf;
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool writeFully(int fd, const void *buf, size_t size) {
+  const char *p = (const char *)buf;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool sendFileFully(int outFd, int fd, off_t offset, u64 size) {
+  while (size > 0) {
+    ssize_t n = sendfile(outFd, fd, &offset, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    size -= n;
+  }
+  return true;
+}
+
+static void setReplyHeader(std::vector<u8> &reply, u32 status, u32 len) {
+  reply.resize(8 + (size_t)len);
+  memcpy(reply.data(), &status, 4);
+  memcpy(reply.data() + 4, &len, 4);
+}
+
+static void setError(std::vector<u8> &reply, std::string const &msg) {
+  setReplyHeader(reply, SERVER_STATUS_ERROR, msg.size());
+  memcpy(reply.data() + 8, msg.data(), msg.size());
+}
+
+static bool isValidateRequest(const char *data, u32 len) {
+  return len >= 4 && memcmp(data, SERVER_VALIDATE_PREFIX, 4) == 0;
+}
+
+// Validation only, from the request alone: no context is taken
+static void handleValidateRequest(std::vector<u8> &reply, const char *data, u32 len) {
+  try {
+    Circom_Validation v = validateWithdraw(data, len);
+    u32 status = v.status;
+    setReplyHeader(reply, SERVER_STATUS_OK, 4 + v.message.size());
+    memcpy(reply.data() + 8, &status, 4);
+    memcpy(reply.data() + 12, v.message.data(), v.message.size());
+  } catch (std::exception &e) {
+    setError(reply, e.what());
+  }
+}
+
+// What a request found in the witness cache
+struct CacheLookup {
+  std::vector<u8> inputs;  // canonical, empty without a cache
+  int fd;  // the cached witness, -1 on a miss
+  off_t offset;
+  u64 size;
+};
+
+// Builds the whole reply, witness included, so that it goes out in one
+// write. A witness found in the cache leaves only the reply header, to be
+// followed by the cached image.
+static void handleRequest(Circom_CalcWitPool *pool, Circom_WitnessCache *cache, std::vector<u8> &reply, CacheLookup &cached, const char *data, u32 len) {
+  Circom_CalcWit *ctx = pool->acquire();
+  cached.inputs.clear();
+  cached.fd = -1;
+  // with a cache, the witness is only computed on a miss
+  ctx->runOnInputs = cache == NULL;
+  try {
+    if (isBinInput(data, len)) {
+      loadBinInputBuffer(ctx, data, len);
+    } else {
+      loadJsonBuffer(ctx, data, len);
+    }
+    if (ctx->getRemaingInputsToBeSet()!=0) {
+      std::ostringstream errStrStream;
+      errStrStream << "Not all inputs have been set. Only " << get_main_input_signal_no()-ctx->getRemaingInputsToBeSet() << " out of " << get_main_input_signal_no() << "\n";
+      throw std::runtime_error(errStrStream.str() );
+    }
+    if (cache != NULL) {
+      Circom_WitnessCache::canonicalInputs(ctx, cached.inputs);
+      cached.fd = cache->lookup(cached.inputs, cached.offset, cached.size);
+      if (cached.fd != -1 && cached.size == getBinWitnessSize()) {
+        setReplyHeader(reply, SERVER_STATUS_OK, cached.size);
+        reply.resize(8);
+      } else {
+        if (cached.fd != -1) close(cached.fd);
+        cached.fd = -1;
+        ctx->runOnInputs = true;
+        ctx->tryRunCircuit();
+      }
+    }
+    if (cached.fd == -1) {
+      setReplyHeader(reply, SERVER_STATUS_OK, getBinWitnessSize());
+      buildBinWitness(ctx, reply.data() + 8);
+    }
+  } catch (std::exception &e) {
+    cached.inputs.clear();
+    setError(reply, e.what());
+  }
+  pool->release(ctx);
+}
+
+static void serve(Circom_CalcWitPool *pool, Circom_WitnessCache *cache, int inFd, int outFd) {
+  std::vector<char> request;
+  std::vector<u8> reply;
+  CacheLookup cached;
+  u32 len;
+  while (readFully(inFd, &len, 4)) {
+    if (len > SERVER_MAX_REQUEST_SIZE) {
+      setError(reply, "Request too large\n");
+      writeFully(outFd, reply.data(), reply.size());
+      break;
+    }
+    request.resize(len);
+    if (!readFully(inFd, request.data(), len)) break;
+    if (isValidateRequest(request.data(), len)) {
+      handleValidateRequest(reply, request.data() + 4, len - 4);
+      if (!writeFully(outFd, reply.data(), reply.size())) break;
+      continue;
+    }
+    handleRequest(pool, cache, reply, cached, request.data(), len);
+    if (cached.fd != -1) {
+      bool sent = writeFully(outFd, reply.data(), reply.size())
+        && sendFileFully(outFd, cached.fd, cached.offset, cached.size);
+      close(cached.fd);
+      if (!sent) break;
+      continue;
+    }
+    if (!writeFully(outFd, reply.data(), reply.size())) break;
+    // after the reply, which does not wait for the file
+    if (!cached.inputs.empty()) {
+      cache->store(cached.inputs, reply.data() + 8, reply.size() - 8);
+    }
+  }
+}
+
+int runStdioServer(Circom_Circuit *circuit, Circom_WitnessCache *cache) {
+  signal(SIGPIPE, SIG_IGN);
+  int outFd = dup(STDOUT_FILENO);
+  if (outFd == -1) {
+    throw std::system_error(errno, std::generic_category(), "dup");
+  }
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+  Circom_CalcWitPool pool(circuit, 1, createDefaultTaskPool(NMUTEXES));
+  serve(&pool, cache, STDIN_FILENO, outFd);
+  close(outFd);
+  return 0;
+}
+
+// Counts the connections being served; the accept loop waits for a free
+// slot before taking the next one
+class ConnectionSlots {
+  std::mutex mutex;
+  std::condition_variable freed;
+  uint active;
+  uint max;
+
+public:
+
+  ConnectionSlots(uint _max) : active(0), max(_max) {}
+
+  void acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    freed.wait(lock, [this]() { return active < max; });
+    active++;
+  }
+
+  void release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    active--;
+    freed.notify_one();
+  }
+};
+
+int runSocketServer(Circom_Circuit *circuit, std::string const &socketPath, Circom_WitnessCache *cache, uint maxConnections) {
+  signal(SIGPIPE, SIG_IGN);
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  if (socketPath.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "Socket path too long: " << socketPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    throw std::system_error(errno, std::generic_category(), "socket");
+  }
+  struct stat sb;
+  if (stat(socketPath.c_str(), &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+    unlink(socketPath.c_str());  // stale socket from a previous run
+  }
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    throw std::system_error(errno, std::generic_category(), "bind");
+  }
+  if (listen(fd, SOMAXCONN) == -1) {
+    throw std::system_error(errno, std::generic_category(), "listen");
+  }
+
+  // shared by all connections; it grows to the number of concurrent ones
+  Circom_CalcWitPool *pool = new Circom_CalcWitPool(circuit, 1, createDefaultTaskPool(NMUTEXES));
+  ConnectionSlots *slots = new ConnectionSlots(maxConnections);
+  for (;;) {
+    slots->acquire();
+    int conn;
+    while ((conn = accept(fd, NULL, NULL)) == -1) {
+      if (errno != EINTR && errno != ECONNABORTED) {
+        throw std::system_error(errno, std::generic_category(), "accept");
+      }
+    }
+    std::thread([pool, cache, slots, conn]() {
+      serve(pool, cache, conn, conn);
+      close(conn);
+      slots->release();
+    }).detach();
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef CIRCOM_SERVER_H
+#define CIRCOM_SERVER_H
+
+#include <string>
+
+#include "circom.hpp"
+
+class Circom_WitnessCache;
+
+/*
+Witness server: keeps the circuit loaded and answers witness requests
+until the peer closes the stream.
+
+Every message is a frame with a little endian header:
+
+  request:  u32 length, followed by length bytes of input JSON or of a
+            binary input (the documents accepted as <input.json|input.bin>)
+  reply:    u32 status, u32 length, followed by length bytes
+            status 0: the .wtns file contents
+            status 1: an error message; the server keeps serving
+
+A request whose document is prefixed with "cval" only validates it, with
+validateWithdraw (validate.hpp), and computes no witness. Its status 0
+reply holds the u32 Circom_ValidationStatus, followed by the message of the
+assert the witness would fail, if any. Malformed inputs are status 1.
+
+With a witness cache (witness_cache.hpp), inputs seen before are answered
+from it with sendfile, and new witnesses are added to it once sent.
+*/
+
+#define SERVER_STATUS_OK 0
+#define SERVER_STATUS_ERROR 1
+
+#define SERVER_VALIDATE_PREFIX "cval"
+
+// Connections served at once by the socket server; further ones wait in
+// the listen backlog until one closes
+#define SERVER_MAX_CONNECTIONS 64
+
+// Serves a single peer on stdin/stdout. Anything the circuit prints is
+// redirected to stderr so it cannot corrupt the reply stream.
+int runStdioServer(Circom_Circuit *circuit, Circom_WitnessCache *cache = NULL);
+
+// Listens on a Unix domain socket, one thread per connection, with at
+// most maxConnections of them.
+int runSocketServer(Circom_Circuit *circuit, std::string const &socketPath, Circom_WitnessCache *cache = NULL, uint maxConnections = SERVER_MAX_CONNECTIONS);
+
+#endif // CIRCOM_SERVER_H
@@ -0,0 +1,472 @@
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "tape.hpp"
+
+Circom_Tape::Circom_Tape() {
+  nSignals = get_total_signal_no();
+  nConstants = 0;
+  nValues = 0;
+  nTemps = 0;
+  compacted = false;
+}
+
+u32 Circom_Tape::constant(const FrRawElement montgomery) {
+  for (uint i = 0; i < constants.size(); i++) {
+    if (Fr_rawIsEq(constants[i].v, montgomery)) return CONSTANT | i;
+  }
+  RawFr::Element e;
+  Fr_rawCopy(e.v, montgomery);
+  constants.push_back(e);
+  return CONSTANT | (u32)(constants.size() - 1);
+}
+
+// Operands to positions in the value array
+void Circom_Tape::finish() {
+  nConstants = constants.size();
+  nValues = nSignals + nConstants + nTemps;
+  u32 base[3] = { 0, nSignals, nSignals + nConstants };
+  for (Circom_TapeOp &op : ops) {
+    op.dst = base[op.dst >> 30] + (op.dst & ~KIND);
+    op.a = base[op.a >> 30] + (op.a & ~KIND);
+    op.b = base[op.b >> 30] + (op.b & ~KIND);
+    op.c = base[op.c >> 30] + (op.c & ~KIND);
+  }
+}
+
+/*****************************************************************************************
+ * Recording
+ *****************************************************************************************/
+
+// State of the recording in progress
+static Circom_Tape *recording = NULL;
+static Circom_CalcWit *recordingCtx = NULL;
+static std::unordered_map<const FrElement*, u32> locals;  // what each local variable holds
+
+Circom_Tape *Circom_Tape::record(Circom_Circuit *circuit) {
+  Circom_Tape *tape = new Circom_Tape();
+  Circom_CalcWit *ctx = new Circom_CalcWit(circuit);
+  ctx->templateFunctions = _traceFunctionTable;
+  recording = tape;
+  recordingCtx = ctx;
+  try {
+    traceRun(ctx);
+  } catch (...) {
+    recording = NULL;
+    recordingCtx = NULL;
+    locals.clear();
+    delete ctx;
+    delete tape;
+    throw;
+  }
+  recording = NULL;
+  recordingCtx = NULL;
+  locals.clear();
+  delete ctx;
+  tape->finish();
+  tape->index();
+  return tape;
+}
+
+Circom_Tape *Tape_recording() {
+  return recording;
+}
+
+static u32 operand(PFrElement a) {
+  FrElement *signals = recordingCtx->signalValues;
+  if (a >= signals && a < signals + recording->nSignals) {
+    return recording->signal(a - signals);
+  }
+  FrElement *constants = recordingCtx->circuitConstants;
+  if (a >= constants && a < constants + get_size_of_constants()) {
+    FrRawElement v;
+    Fr_toRawMontgomery(v, a);
+    return recording->constant(v);
+  }
+  auto it = locals.find(a);
+  if (it == locals.end()) {
+    throw std::runtime_error("Tape recording: read of an unset local value\n");
+  }
+  return it->second;
+}
+
+static inline bool isConstant(u32 x) {
+  return (x & Circom_Tape::KIND) == Circom_Tape::CONSTANT;
+}
+
+static inline void constantElement(FrElement *r, u32 x) {
+  Fr_fromRawMontgomery(r, recording->constants[x & ~Circom_Tape::KIND].v);
+}
+
+static inline u32 foldedConstant(PFrElement a) {
+  FrRawElement v;
+  Fr_toRawMontgomery(v, a);
+  return recording->constant(v);
+}
+
+static inline bool isSignal(PFrElement r) {
+  FrElement *signals = recordingCtx->signalValues;
+  return r >= signals && r < signals + recording->nSignals;
+}
+
+// r takes the value x: a copy into a signal, or a local that now names x
+static void assign(PFrElement r, u32 x) {
+  if (isSignal(r)) {
+    recording->emit(TAPE_COPY, recording->signal(r - recordingCtx->signalValues), x);
+  } else {
+    locals[r] = x;
+  }
+}
+
+// r = code(x, y), into r directly when r is a signal
+static void emitResult(PFrElement r, u32 code, u32 x, u32 y) {
+  if (isSignal(r)) {
+    recording->emit(code, recording->signal(r - recordingCtx->signalValues), x, y);
+  } else {
+    u32 t = recording->temp();
+    recording->emit(code, t, x, y);
+    locals[r] = t;
+  }
+}
+
+typedef void (*FrBinaryOp)(PFrElement r, PFrElement a, PFrElement b);
+typedef void (*FrUnaryOp)(PFrElement r, PFrElement a);
+
+static void unsupported(const char *op) {
+  std::ostringstream errStrStream;
+  errStrStream << "Tape recording: " << op << " of signal values is not supported\n";
+  throw std::runtime_error(errStrStream.str());
+}
+
+static void binary(PFrElement r, PFrElement a, PFrElement b, FrBinaryOp fn, u32 code, const char *name) {
+  u32 x = operand(a);
+  u32 y = operand(b);
+  if (isConstant(x) && isConstant(y)) {
+    FrElement ea, eb, er;
+    constantElement(&ea, x);
+    constantElement(&eb, y);
+    fn(&er, &ea, &eb);
+    assign(r, foldedConstant(&er));
+  } else if (name != NULL) {
+    unsupported(name);
+  } else {
+    emitResult(r, code, x, y);
+  }
+}
+
+static void unary(PFrElement r, PFrElement a, FrUnaryOp fn, u32 code) {
+  u32 x = operand(a);
+  if (isConstant(x)) {
+    FrElement ea, er;
+    constantElement(&ea, x);
+    fn(&er, &ea);
+    assign(r, foldedConstant(&er));
+  } else {
+    emitResult(r, code, x, 0);
+  }
+}
+
+void Tape_copy(PFrElement r, PFrElement a) {
+  assign(r, operand(a));
+}
+
+void Tape_add(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_add, TAPE_ADD, NULL); }
+void Tape_sub(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_sub, TAPE_SUB, NULL); }
+void Tape_mul(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_mul, TAPE_MUL, NULL); }
+void Tape_eq(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_eq, TAPE_EQ, NULL); }
+void Tape_neq(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_neq, TAPE_NEQ, NULL); }
+void Tape_lt(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_lt, 0, "comparison"); }
+void Tape_gt(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_gt, 0, "comparison"); }
+void Tape_leq(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_leq, 0, "comparison"); }
+void Tape_geq(PFrElement r, PFrElement a, PFrElement b) { binary(r, a, b, Fr_geq, 0, "comparison"); }
+void Tape_square(PFrElement r, PFrElement a) { unary(r, a, Fr_square, TAPE_SQUARE); }
+void Tape_neg(PFrElement r, PFrElement a) { unary(r, a, Fr_neg, TAPE_NEG); }
+
+int Tape_isTrue(PFrElement a) {
+  u32 x = operand(a);
+  if (!isConstant(x)) {
+    throw std::runtime_error("Tape recording: a branch depends on signal values\n");
+  }
+  FrElement e;
+  constantElement(&e, x);
+  return Fr_isTrue(&e);
+}
+
+// Asserts on signal values are recorded, and taken as passed
+void Tape_assert(Circom_CalcWit *ctx, PFrElement a, const char *templateName, uint line, u64 id) {
+  u32 x = operand(a);
+  if (isConstant(x)) {
+    FrElement e;
+    constantElement(&e, x);
+    Circom_assert(ctx, &e, templateName, line, id);
+    return;
+  }
+  recording->emit(TAPE_ASSERT, recording->assertMessages.size(), x);
+  recording->assertMessages.push_back(Circom_assertMessage(ctx, templateName, line, id));
+}
+
+int Tape_toInt(PFrElement a) {
+  u32 x = operand(a);
+  if (!isConstant(x)) {
+    throw std::runtime_error("Tape recording: an index depends on signal values\n");
+  }
+  FrElement e;
+  constantElement(&e, x);
+  return Fr_toInt(&e);
+}
+
+/*****************************************************************************************
+ * Replay
+ *****************************************************************************************/
+
+void Circom_Tape::assertFailed(const Circom_TapeOp &op) {
+  throw Circom_AssertError(assertMessages[op.dst]);
+}
+
+void Circom_Tape::run(Circom_CalcWit *ctx) {
+  thread_local std::vector<RawFr::Element> buffer;
+  if (buffer.size() < nValues) buffer.resize(nValues);
+  RawFr::Element *v = buffer.data();
+  memcpy(&v[nSignals], constants.data(), nConstants * sizeof(RawFr::Element));
+
+  uint nInputs = get_main_input_signal_start() + get_main_input_signal_no();
+  for (uint s = 0; s < nInputs; s++) {
+    Fr_toRawMontgomery(v[s].v, &ctx->signalValues[s]);
+  }
+
+  const Circom_TapeOp *op = ops.data();
+  const Circom_TapeOp *end = op + ops.size();
+  for (; op != end; op++) {
+    if (op->code == TAPE_ASSERT) {
+      if (Fr_rawIsZero(v[op->a].v)) {
+        assertFailed(*op);
+      }
+    } else {
+      Tape_evaluate(op->code, v[op->dst].v, v[op->a].v, v[op->b].v, v[op->c].v);
+    }
+  }
+
+  for (uint s = nInputs; s < nSignals; s++) {
+    Fr_fromRawMontgomery(&ctx->signalValues[s], v[s].v);
+  }
+}
+
+// Readers and definition of every value, for rerun
+void Circom_Tape::index() {
+  readerStart.assign(nValues + 1, 0);
+  definedBy.assign(nValues, ~0u);
+  inputsOfOp.assign(ops.size(), 0);
+  for (u32 i = 0; i < ops.size(); i++) {
+    const Circom_TapeOp &op = ops[i];
+    const u32 operands[3] = { op.a, op.b, op.c };
+    for (uint k = 0; k < 3; k++) {
+      u32 x = operands[k];
+      if ((k > 0 && x == op.a) || (k > 1 && x == op.b)) continue;
+      readerStart[x + 1]++;
+      bool known = x == 0 || (x >= nSignals && x < nSignals + nConstants);
+      if (!known) inputsOfOp[i]++;
+    }
+  }
+  for (uint x = 0; x < nValues; x++) readerStart[x + 1] += readerStart[x];
+  readers.resize(readerStart[nValues]);
+  std::vector<u32> fill(readerStart.begin(), readerStart.end() - 1);
+  for (u32 i = 0; i < ops.size(); i++) {
+    const Circom_TapeOp &op = ops[i];
+    readers[fill[op.a]++] = i;
+    if (op.b != op.a) readers[fill[op.b]++] = i;
+    if (op.c != op.a && op.c != op.b) readers[fill[op.c]++] = i;
+    if (op.code != TAPE_ASSERT) definedBy[op.dst] = i;
+  }
+}
+
+uint Circom_Tape::rerun(Circom_CalcWit *ctx, const std::vector<uint> &changed) {
+  if (compacted) {
+    run(ctx);
+    return ops.size();
+  }
+  // marks are stamped with the generation of the call, so that nothing has
+  // to be cleared between calls
+  thread_local u32 generation = 0;
+  thread_local std::vector<RawFr::Element> buffer;
+  thread_local std::vector<u32> dirtyMarks, readMarks, opMarks;
+  thread_local std::vector<u32> selectedBuffer, pendingBuffer;
+  if (buffer.size() < nValues) buffer.resize(nValues);
+  if (++generation == 0 || dirtyMarks.size() < nValues || opMarks.size() < ops.size()) {
+    generation = 1;
+    dirtyMarks.assign(std::max<size_t>(dirtyMarks.size(), nValues), 0);
+    readMarks.assign(dirtyMarks.size(), 0);
+    opMarks.assign(std::max<size_t>(opMarks.size(), ops.size()), 0);
+  }
+  u32 gen = generation;
+  RawFr::Element *v = buffer.data();
+  u32 *dirty = dirtyMarks.data();
+  u32 *read = readMarks.data();
+  u32 *opMark = opMarks.data();
+  std::vector<u32> &selected = selectedBuffer;
+  std::vector<u32> &pending = pendingBuffer;
+  selected.clear();
+  pending.clear();
+  memcpy(&v[nSignals], constants.data(), nConstants * sizeof(RawFr::Element));
+
+  // what the changes reach
+  for (uint s : changed) {
+    if (dirty[s] == gen) continue;
+    Fr_toRawMontgomery(v[s].v, &ctx->signalValues[s]);
+    dirty[s] = gen;
+    pending.push_back(s);
+  }
+  while (!pending.empty()) {
+    u32 x = pending.back();
+    pending.pop_back();
+    for (u32 r = readerStart[x]; r < readerStart[x + 1]; r++) {
+      u32 i = readers[r];
+      if (opMark[i] == gen) continue;
+      opMark[i] = gen;
+      selected.push_back(i);
+      const Circom_TapeOp &op = ops[i];
+      if (op.code != TAPE_ASSERT && dirty[op.dst] != gen) {
+        dirty[op.dst] = gen;
+        pending.push_back(op.dst);
+      }
+    }
+  }
+  // most of the tape: a plain run costs less than the bookkeeping
+  if (selected.size() > ops.size() / 2) {
+    run(ctx);
+    return ops.size();
+  }
+  // and the unchanged temporaries it reads, which are not kept between
+  // runs, with what they read in turn
+  uint tempStart = nSignals + nConstants;
+  for (uint k = 0; k < selected.size(); k++) {
+    const Circom_TapeOp &op = ops[selected[k]];
+    const u32 operands[3] = { op.a, op.b, op.c };
+    for (u32 x : operands) {
+      if (x < tempStart || dirty[x] == gen || read[x] == gen) continue;
+      read[x] = gen;
+      u32 i = definedBy[x];
+      if (opMark[i] != gen) {
+        opMark[i] = gen;
+        selected.push_back(i);
+      }
+    }
+  }
+  // back in tape order; by a scan of the marks when that is cheaper
+  if (selected.size() < ops.size() / 16) {
+    std::sort(selected.begin(), selected.end());
+  } else {
+    selected.clear();
+    for (u32 i = 0; i < ops.size(); i++) {
+      if (opMark[i] == gen) selected.push_back(i);
+    }
+  }
+
+  for (u32 i : selected) {
+    const Circom_TapeOp &op = ops[i];
+    const u32 operands[3] = { op.a, op.b, op.c };
+    for (u32 x : operands) {
+      if (x < nSignals && dirty[x] != gen && read[x] != gen) {
+        Fr_toRawMontgomery(v[x].v, &ctx->signalValues[x]);
+        read[x] = gen;
+      }
+    }
+    if (op.code == TAPE_ASSERT) {
+      if (Fr_rawIsZero(v[op.a].v)) {
+        assertFailed(op);
+      }
+    } else {
+      Tape_evaluate(op.code, v[op.dst].v, v[op.a].v, v[op.b].v, v[op.c].v);
+    }
+  }
+
+  for (u32 i : selected) {
+    const Circom_TapeOp &op = ops[i];
+    if (op.code != TAPE_ASSERT && op.dst < nSignals) {
+      Fr_fromRawMontgomery(&ctx->signalValues[op.dst], v[op.dst].v);
+    }
+  }
+  return selected.size();
+}
+
+/*****************************************************************************************
+ * Progressive evaluation
+ *****************************************************************************************/
+
+void Circom_Tape::execute(Circom_TapeProgress &progress, u32 i) {
+  const Circom_TapeOp &op = ops[i];
+  RawFr::Element *v = progress.values.data();
+  if (op.code == TAPE_ASSERT) {
+    if (Fr_rawIsZero(v[op.a].v)) {
+      assertFailed(op);
+    }
+  } else {
+    Tape_evaluate(op.code, v[op.dst].v, v[op.a].v, v[op.b].v, v[op.c].v);
+    progress.pending.push_back(op.dst);
+  }
+}
+
+// Tells the readers of the pending values, running those that become ready
+void Circom_Tape::propagate(Circom_TapeProgress &progress) {
+  u8 *missing = progress.missing.data();
+  while (!progress.pending.empty()) {
+    u32 x = progress.pending.back();
+    progress.pending.pop_back();
+    for (u32 r = readerStart[x]; r < readerStart[x + 1]; r++) {
+      u32 i = readers[r];
+      if (--missing[i] == 0) execute(progress, i);
+    }
+  }
+}
+
+void Circom_Tape::advance(Circom_TapeProgress &progress, Circom_CalcWit *ctx, uint first, uint n) {
+  // scratch slots are reused: everything waits for finish, as a plain run
+  if (compacted) return;
+  if (!progress.started) {
+    progress.values.resize(nValues);
+    progress.missing = inputsOfOp;
+    progress.pending.clear();
+    progress.started = true;
+    memcpy(&progress.values[nSignals], constants.data(), nConstants * sizeof(RawFr::Element));
+    Fr_toRawMontgomery(progress.values[0].v, &ctx->signalValues[0]);
+    // what only reads constants
+    for (u32 i = 0; i < ops.size(); i++) {
+      if (inputsOfOp[i] == 0) execute(progress, i);
+    }
+    propagate(progress);
+  }
+  for (uint s = first; s < first + n; s++) {
+    Fr_toRawMontgomery(progress.values[s].v, &ctx->signalValues[s]);
+    progress.pending.push_back(s);
+  }
+  propagate(progress);
+}
+
+// The rest in tape order, which needs no readers to be told: what is still
+// missing operands when the last input arrives is exactly what has not run
+void Circom_Tape::finish(Circom_TapeProgress &progress, Circom_CalcWit *ctx) {
+  uint nInputs = get_main_input_signal_start() + get_main_input_signal_no();
+  RawFr::Element *v = progress.values.data();
+  for (uint s = get_main_input_signal_start(); s < nInputs; s++) {
+    Fr_toRawMontgomery(v[s].v, &ctx->signalValues[s]);
+  }
+  const u8 *missing = progress.missing.data();
+  for (u32 i = 0; i < ops.size(); i++) {
+    if (missing[i] == 0) continue;
+    const Circom_TapeOp &op = ops[i];
+    if (op.code == TAPE_ASSERT) {
+      if (Fr_rawIsZero(v[op.a].v)) {
+        progress.started = false;
+        assertFailed(op);
+      }
+    } else {
+      Tape_evaluate(op.code, v[op.dst].v, v[op.a].v, v[op.b].v, v[op.c].v);
+    }
+  }
+  for (uint s = nInputs; s < nSignals; s++) {
+    Fr_fromRawMontgomery(&ctx->signalValues[s], progress.values[s].v);
+  }
+  progress.started = false;
+}
@@ -0,0 +1,212 @@
+#ifndef CIRCOM_TAPE_H
+#define CIRCOM_TAPE_H
+
+#include <string>
+#include <vector>
+
+#include "circom.hpp"
+#include "calcwit.hpp"
+#include "fr.hpp"
+
+// Operation tape: the dataflow of the circuit as a flat list of field
+// operations, replayed for every witness instead of running the templates.
+//
+// The tape is recorded once, by running the generated code with the field
+// operations replaced by the recorder's (tape_trace.cpp). Operations whose
+// operands are all constants, such as loop counters and signal offsets,
+// are evaluated while recording and leave nothing behind. The others
+// become entries over one value array, all in Montgomery form:
+//
+//   [0, nSignals)                        signals
+//   [nSignals, nSignals + nConstants)    constants
+//   [nSignals + nConstants, nValues)     temporaries
+//
+// Control flow may only depend on constants. Recording throws if a signal
+// value decides a branch or an index; circuit asserts, which go through
+// Circom_assert rather than a branch, become TAPE_ASSERT.
+
+enum Circom_TapeOpCode : u32 {
+  TAPE_COPY,     // dst = a
+  TAPE_ADD,      // dst = a + b
+  TAPE_SUB,      // dst = a - b
+  TAPE_MUL,      // dst = a * b
+  TAPE_SQUARE,   // dst = a * a
+  TAPE_NEG,      // dst = -a
+  TAPE_EQ,       // dst = a == b
+  TAPE_NEQ,      // dst = a != b
+  TAPE_SELECT,   // dst = a - c*(a - b): a if c is 0, b if c is 1
+  TAPE_ASSERT    // fails the witness if a is zero, with assertMessages[dst]
+};
+
+struct Circom_TapeOp {
+  u32 code;
+  u32 dst;
+  u32 a;
+  u32 b;
+  u32 c;
+};
+
+// One witness computed by Circom_Tape::advance as its inputs arrive
+struct Circom_TapeProgress {
+  bool started;
+  std::vector<RawFr::Element> values;
+  std::vector<u8> missing;    // operands of each operation not known yet
+  std::vector<u32> pending;   // values known, whose readers are not told yet
+
+  Circom_TapeProgress() : started(false) {}
+};
+
+class Circom_Tape {
+
+public:
+
+  uint nSignals;
+  uint nConstants;
+  uint nValues;
+  std::vector<Circom_TapeOp> ops;
+  std::vector<RawFr::Element> constants;
+  // circom's message for each assert, with its template, line and trace
+  std::vector<std::string> assertMessages;
+  // set by compactMemory: [0, nSignals) are the witness entries, and the
+  // contexts of the circuit map the witness through these tables instead
+  // of the circuit's
+  bool compacted;
+  std::vector<u64> witness2Signal;
+  std::vector<Circom_WitnessRun> witnessRuns;
+
+  // Records the tape of the main component. Not thread safe: meant to be
+  // called once, before any witness is computed.
+  static Circom_Tape *record(Circom_Circuit *circuit);
+
+  // Computes every signal of ctx from its main inputs. Throws
+  // Circom_AssertError if an assert of the circuit fails.
+  void run(Circom_CalcWit *ctx);
+
+  // Brings ctx, already computed, up to date after the signals in changed
+  // were given new values: runs only the operations that depend on them,
+  // and the temporaries those read, with the other operands taken from
+  // ctx; a plain run when the changes reach most of the tape. Returns the
+  // number of operations run. ctx is left untouched if an assert fails.
+  uint rerun(Circom_CalcWit *ctx, const std::vector<uint> &changed);
+
+  // Progressive evaluation: advance() is told that signals [first, first+n)
+  // of ctx were set and runs every operation whose operands are all known
+  // by then, so that what only depends on the inputs given so far is done
+  // before the last one arrives. Throws as soon as an assert fails.
+  // finish() runs the rest once every input was given, and writes the
+  // signals back.
+  void advance(Circom_TapeProgress &progress, Circom_CalcWit *ctx, uint first, uint n);
+  void finish(Circom_TapeProgress &progress, Circom_CalcWit *ctx);
+
+  // Rewrites the tape into an equivalent, shorter one (tape_opt.cpp):
+  // constant folding and copy propagation, common subexpressions, 0/1
+  // selectors, and removal of everything no witness entry or assert
+  // depends on. Signals outside the witness may be left unset after that.
+  void optimize(Circom_Circuit *circuit);
+
+  // Compact memory layout, after optimize (tape_opt.cpp): contexts hold
+  // only the witness, in witness order, and every other signal and
+  // temporary gets a scratch slot for as long as it is live, reused after.
+  // Contexts of the circuit created after that allocate and write
+  // get_size_of_witness() values, through the tape's witness tables; the
+  // circuit's are left as they are, and only the tape can fill such a
+  // context: not the templates, nor the lockstep engine. rerun() and
+  // advance() need each value to stay where it was computed, and fall back
+  // to a plain run once compacted.
+  void compactMemory(Circom_Circuit *circuit);
+
+  /* Recording */
+
+  // operands are tagged with their kind until the tape is finished
+  static const u32 SIGNAL = 0u << 30;
+  static const u32 CONSTANT = 1u << 30;
+  static const u32 TEMP = 2u << 30;
+  static const u32 KIND = 3u << 30;
+
+  inline u32 signal(u64 idx) { return SIGNAL | (u32)idx; }
+  u32 constant(const FrRawElement montgomery);
+  inline u32 temp() { return TEMP | nTemps++; }
+  inline void emit(u32 code, u32 dst, u32 a, u32 b = 0) {
+    Circom_TapeOp op = { code, dst, a, b, 0 };
+    ops.push_back(op);
+  }
+
+private:
+
+  uint nTemps;
+
+  // for rerun: the operations reading value x are
+  // readers[readerStart[x] .. readerStart[x+1]), and definedBy[x] writes it
+  std::vector<u32> readerStart;
+  std::vector<u32> readers;
+  std::vector<u32> definedBy;
+  // for advance: operands of each operation that are neither constants nor
+  // the constant one signal, counted once each
+  std::vector<u8> inputsOfOp;
+
+  Circom_Tape();
+  void finish();
+  void index();
+  [[noreturn]] void assertFailed(const Circom_TapeOp &op);
+  void execute(Circom_TapeProgress &progress, u32 i);
+  void propagate(Circom_TapeProgress &progress);
+};
+
+// r = code(a, b, c) for every code but TAPE_ASSERT
+static inline void Tape_evaluate(u32 code, FrRawElement r, const FrRawElement a, const FrRawElement b, const FrRawElement c) {
+  switch (code) {
+    case TAPE_COPY: Fr_rawCopy(r, a); break;
+    case TAPE_ADD: Fr_rawAdd(r, a, b); break;
+    case TAPE_SUB: Fr_rawSub(r, a, b); break;
+    case TAPE_MUL: Fr_rawMMul(r, a, b); break;
+    case TAPE_SQUARE: Fr_rawMSquare(r, a); break;
+    case TAPE_NEG: Fr_rawNeg(r, a); break;
+    case TAPE_EQ:
+      Fr_rawCopy(r, Fr_rawIsEq(a, b) ? RawFr::field.one().v : RawFr::field.zero().v);
+      break;
+    case TAPE_NEQ:
+      Fr_rawCopy(r, Fr_rawIsEq(a, b) ? RawFr::field.zero().v : RawFr::field.one().v);
+      break;
+    case TAPE_SELECT:
+      if (Fr_rawIsZero(c)) {
+        Fr_rawCopy(r, a);
+      } else if (Fr_rawIsEq(c, RawFr::field.one().v)) {
+        Fr_rawCopy(r, b);
+      } else {
+        FrRawElement d;
+        Fr_rawSub(d, a, b);
+        Fr_rawMMul(d, c, d);
+        Fr_rawSub(r, a, d);
+      }
+      break;
+  }
+}
+
+// the tape being recorded, NULL outside Circom_Tape::record
+Circom_Tape *Tape_recording();
+
+// MiMC7_0_run as tape operations (mimc7.cpp)
+void MiMC7_0_record(Circom_Tape *tape, u64 signalStart);
+
+// The traced copy of the templates (tape_trace.cpp)
+extern Circom_TemplateFunction *_traceFunctionTable;
+void traceRun(Circom_CalcWit *ctx);
+
+// Field operations of the traced templates
+void Tape_copy(PFrElement r, PFrElement a);
+void Tape_add(PFrElement r, PFrElement a, PFrElement b);
+void Tape_sub(PFrElement r, PFrElement a, PFrElement b);
+void Tape_mul(PFrElement r, PFrElement a, PFrElement b);
+void Tape_square(PFrElement r, PFrElement a);
+void Tape_neg(PFrElement r, PFrElement a);
+void Tape_eq(PFrElement r, PFrElement a, PFrElement b);
+void Tape_neq(PFrElement r, PFrElement a, PFrElement b);
+void Tape_lt(PFrElement r, PFrElement a, PFrElement b);
+void Tape_gt(PFrElement r, PFrElement a, PFrElement b);
+void Tape_leq(PFrElement r, PFrElement a, PFrElement b);
+void Tape_geq(PFrElement r, PFrElement a, PFrElement b);
+int Tape_isTrue(PFrElement a);
+void Tape_assert(Circom_CalcWit *ctx, PFrElement a, const char *templateName, uint line, u64 id);
+int Tape_toInt(PFrElement a);
+
+#endif // CIRCOM_TAPE_H
@@ -0,0 +1,386 @@
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "tape.hpp"
+
+// Tape optimizer. A recorded tape writes every signal and temporary once, so
+// a value is named by the position it is stored at, and the passes below can
+// rename and reorder freely on that basis:
+//
+//   fold       constants and copies propagated into the operands, operations
+//              on constants evaluated, identities (x + 0, x * 1, ...) and
+//              repeated operations replaced by the value already computed;
+//   selectors  h - p*(h - e) as one TAPE_SELECT, which skips the multiply
+//              when p is 0 or 1 (the Merkle path indices);
+//   copies     a temporary copied into a signal computed into it directly;
+//   dead       operations no witness entry or assert depends on removed;
+//   compact    constants and temporaries renumbered to what is left.
+//
+// Signals the optimized tape does not write keep whatever the buffer had.
+
+static const u32 NONE = ~0u;
+
+static inline uint nOperands(u32 code) {
+  switch (code) {
+    case TAPE_COPY: case TAPE_SQUARE: case TAPE_NEG: case TAPE_ASSERT: return 1;
+    case TAPE_SELECT: return 3;
+    default: return 2;
+  }
+}
+
+static inline u32 &operand(Circom_TapeOp &op, uint i) {
+  return i == 0 ? op.a : (i == 1 ? op.b : op.c);
+}
+
+static inline bool isCommutative(u32 code) {
+  return code == TAPE_ADD || code == TAPE_MUL || code == TAPE_EQ || code == TAPE_NEQ;
+}
+
+// Values during the optimization: the tape's, plus the constants found by
+// folding, which are numbered from tape.nValues on until compact()
+class Circom_TapeValues {
+public:
+  Circom_Tape &tape;
+  u32 constantsEnd;
+  std::vector<RawFr::Element> folded;
+
+  Circom_TapeValues(Circom_Tape &aTape) : tape(aTape) {
+    constantsEnd = tape.nSignals + tape.nConstants;
+  }
+
+  inline bool isConstant(u32 x) {
+    return (x >= tape.nSignals && x < constantsEnd) || x >= tape.nValues;
+  }
+  inline bool isTemp(u32 x) {
+    return x >= constantsEnd && x < tape.nValues;
+  }
+  inline const RawFr::Element &value(u32 x) {
+    return x < tape.nValues ? tape.constants[x - tape.nSignals] : folded[x - tape.nValues];
+  }
+  inline bool isZero(u32 x) {
+    return isConstant(x) && Fr_rawIsZero(value(x).v);
+  }
+  inline bool isOne(u32 x) {
+    return isConstant(x) && Fr_rawIsEq(value(x).v, RawFr::field.one().v);
+  }
+
+  u32 constant(const RawFr::Element &e) {
+    for (uint i = 0; i < tape.nConstants; i++) {
+      if (Fr_rawIsEq(tape.constants[i].v, e.v)) return tape.nSignals + i;
+    }
+    for (uint i = 0; i < folded.size(); i++) {
+      if (Fr_rawIsEq(folded[i].v, e.v)) return tape.nValues + i;
+    }
+    folded.push_back(e);
+    return tape.nValues + folded.size() - 1;
+  }
+};
+
+// The value op computes when that is known without running it, else NONE
+static u32 simplify(Circom_TapeValues &values, Circom_TapeOp &op) {
+  bool allConstant = true;
+  for (uint i = 0; i < nOperands(op.code); i++) {
+    allConstant = allConstant && values.isConstant(operand(op, i));
+  }
+  if (allConstant) {
+    RawFr::Element r;
+    Tape_evaluate(op.code, r.v, values.value(op.a).v,
+      values.value(nOperands(op.code) > 1 ? op.b : op.a).v,
+      values.value(nOperands(op.code) > 2 ? op.c : op.a).v);
+    return values.constant(r);
+  }
+  switch (op.code) {
+    case TAPE_COPY:
+      return op.a;
+    case TAPE_ADD:
+      if (values.isZero(op.a)) return op.b;
+      if (values.isZero(op.b)) return op.a;
+      break;
+    case TAPE_SUB:
+      if (values.isZero(op.b)) return op.a;
+      if (op.a == op.b) return values.constant(RawFr::field.zero());
+      break;
+    case TAPE_MUL:
+      if (values.isZero(op.a) || values.isZero(op.b)) return values.constant(RawFr::field.zero());
+      if (values.isOne(op.a)) return op.b;
+      if (values.isOne(op.b)) return op.a;
+      break;
+    case TAPE_EQ:
+      if (op.a == op.b) return values.constant(RawFr::field.one());
+      break;
+    case TAPE_NEQ:
+      if (op.a == op.b) return values.constant(RawFr::field.zero());
+      break;
+    case TAPE_SELECT:
+      if (values.isZero(op.c) || op.a == op.b) return op.a;
+      if (values.isOne(op.c)) return op.b;
+      break;
+  }
+  return NONE;
+}
+
+static std::vector<Circom_TapeOp> fold(Circom_TapeValues &values, const std::vector<Circom_TapeOp> &ops) {
+  Circom_Tape &tape = values.tape;
+  std::vector<u32> repl(tape.nValues);
+  for (u32 x = 0; x < tape.nValues; x++) repl[x] = x;
+  std::map<std::tuple<u32, u32, u32, u32>, u32> computed;
+  std::vector<Circom_TapeOp> result;
+  result.reserve(ops.size());
+
+  for (Circom_TapeOp op : ops) {
+    uint n = nOperands(op.code);
+    for (uint i = 0; i < 3; i++) {
+      u32 &x = operand(op, i);
+      x = i < n ? (x < repl.size() ? repl[x] : x) : 0;
+    }
+    if (op.code == TAPE_ASSERT) {
+      if (!values.isConstant(op.a) || values.isZero(op.a)) result.push_back(op);
+      continue;
+    }
+    if (isCommutative(op.code) && op.a > op.b) std::swap(op.a, op.b);
+    if (op.code == TAPE_MUL && op.a == op.b) {
+      op.code = TAPE_SQUARE;
+      op.b = 0;
+    }
+
+    u32 known = simplify(values, op);
+    if (known == NONE) {
+      auto key = std::make_tuple(op.code, op.a, op.b, op.c);
+      auto it = computed.find(key);
+      if (it != computed.end()) {
+        known = it->second;
+      } else {
+        computed[key] = op.dst;
+        result.push_back(op);
+        continue;
+      }
+    }
+    // readers get the known value; a signal still has to be written
+    repl[op.dst] = known;
+    if (op.dst < tape.nSignals) {
+      Circom_TapeOp copy = { TAPE_COPY, op.dst, known, 0, 0 };
+      result.push_back(copy);
+    }
+  }
+  return result;
+}
+
+// Position of the operation that defines each value, NONE for the others
+static std::vector<u32> definitions(Circom_TapeValues &values, const std::vector<Circom_TapeOp> &ops) {
+  std::vector<u32> def(values.tape.nValues + values.folded.size(), NONE);
+  for (u32 i = 0; i < ops.size(); i++) {
+    if (ops[i].code != TAPE_ASSERT) def[ops[i].dst] = i;
+  }
+  return def;
+}
+
+static std::vector<u32> useCounts(Circom_TapeValues &values, std::vector<Circom_TapeOp> &ops) {
+  std::vector<u32> uses(values.tape.nValues + values.folded.size(), 0);
+  for (Circom_TapeOp &op : ops) {
+    for (uint i = 0; i < nOperands(op.code); i++) uses[operand(op, i)]++;
+  }
+  return uses;
+}
+
+static std::vector<Circom_TapeOp> selectors(Circom_TapeValues &values, std::vector<Circom_TapeOp> &ops) {
+  std::vector<u32> def = definitions(values, ops);
+  std::vector<u32> uses = useCounts(values, ops);
+  std::vector<bool> removed(ops.size(), false);
+
+  // the temporary named x, defined by a `code` operation and read once
+  auto single = [&](u32 x, u32 code) -> Circom_TapeOp* {
+    if (!values.isTemp(x) || uses[x] != 1 || def[x] == NONE) return NULL;
+    Circom_TapeOp *op = &ops[def[x]];
+    return op->code == code ? op : NULL;
+  };
+
+  for (Circom_TapeOp &op : ops) {
+    if (op.code != TAPE_SUB || removed[&op - ops.data()]) continue;
+    Circom_TapeOp *mul = single(op.b, TAPE_MUL);
+    if (mul == NULL) continue;
+    for (uint i = 0; i < 2; i++) {
+      Circom_TapeOp *sub = single(operand(*mul, i), TAPE_SUB);
+      if (sub == NULL || sub->a != op.a) continue;
+      // op.dst = x - p*(x - y)
+      u32 p = operand(*mul, 1 - i);
+      removed[mul - ops.data()] = true;
+      removed[sub - ops.data()] = true;
+      op.code = TAPE_SELECT;
+      op.b = sub->b;
+      op.c = p;
+      break;
+    }
+  }
+
+  std::vector<Circom_TapeOp> result;
+  for (u32 i = 0; i < ops.size(); i++) {
+    if (!removed[i]) result.push_back(ops[i]);
+  }
+  return result;
+}
+
+static std::vector<Circom_TapeOp> copies(Circom_TapeValues &values, std::vector<Circom_TapeOp> &ops) {
+  // positions in result
+  std::vector<u32> def(values.tape.nValues + values.folded.size(), NONE);
+  std::vector<u32> rename(def.size());
+  for (u32 x = 0; x < rename.size(); x++) rename[x] = x;
+
+  std::vector<Circom_TapeOp> result;
+  for (Circom_TapeOp op : ops) {
+    if (op.code == TAPE_COPY && op.dst < values.tape.nSignals && values.isTemp(op.a) && def[op.a] != NONE) {
+      // the signal takes the place of the temporary, defined earlier
+      result[def[op.a]].dst = op.dst;
+      rename[op.a] = op.dst;
+      def[op.a] = NONE;
+      continue;
+    }
+    if (op.code != TAPE_ASSERT) def[op.dst] = result.size();
+    result.push_back(op);
+  }
+  for (Circom_TapeOp &op : result) {
+    for (uint i = 0; i < nOperands(op.code); i++) operand(op, i) = rename[operand(op, i)];
+  }
+  return result;
+}
+
+static std::vector<Circom_TapeOp> dead(Circom_TapeValues &values, Circom_Circuit *circuit, std::vector<Circom_TapeOp> &ops) {
+  std::vector<bool> live(values.tape.nValues + values.folded.size(), false);
+  for (uint i = 0; i < get_size_of_witness(); i++) {
+    live[circuit->witness2SignalList[i]] = true;
+  }
+  std::vector<bool> kept(ops.size(), false);
+  for (u32 i = ops.size(); i-- > 0; ) {
+    Circom_TapeOp &op = ops[i];
+    if (op.code != TAPE_ASSERT && !live[op.dst]) continue;
+    kept[i] = true;
+    for (uint j = 0; j < nOperands(op.code); j++) live[operand(op, j)] = true;
+  }
+  std::vector<Circom_TapeOp> result;
+  for (u32 i = 0; i < ops.size(); i++) {
+    if (kept[i]) result.push_back(ops[i]);
+  }
+  return result;
+}
+
+// Back to the layout of tape.hpp, with only the constants and temporaries
+// still in use
+static void compact(Circom_TapeValues &values, std::vector<Circom_TapeOp> &ops) {
+  Circom_Tape &tape = values.tape;
+  std::vector<u32> position(tape.nValues + values.folded.size(), NONE);
+  std::vector<RawFr::Element> constants;
+  for (Circom_TapeOp &op : ops) {
+    for (uint i = 0; i < nOperands(op.code); i++) {
+      u32 x = operand(op, i);
+      if (values.isConstant(x) && position[x] == NONE) {
+        position[x] = tape.nSignals + constants.size();
+        constants.push_back(values.value(x));
+      }
+    }
+  }
+  u32 next = tape.nSignals + constants.size();
+  for (Circom_TapeOp &op : ops) {
+    if (op.code != TAPE_ASSERT && values.isTemp(op.dst)) position[op.dst] = next++;
+  }
+  for (Circom_TapeOp &op : ops) {
+    if (op.code != TAPE_ASSERT && op.dst >= tape.nSignals) op.dst = position[op.dst];
+    for (uint i = 0; i < nOperands(op.code); i++) {
+      u32 &x = operand(op, i);
+      if (x >= tape.nSignals) x = position[x];
+    }
+  }
+  tape.constants = constants;
+  tape.nConstants = constants.size();
+  tape.nValues = next;
+}
+
+void Circom_Tape::optimize(Circom_Circuit *circuit) {
+  Circom_TapeValues values(*this);
+  std::vector<Circom_TapeOp> result = fold(values, ops);
+  result = selectors(values, result);
+  result = copies(values, result);
+  result = dead(values, circuit, result);
+  compact(values, result);
+  ops = result;
+  index();
+}
+
+// Compact memory layout. Only the witness is kept: the value array becomes
+//
+//   [0, nWitness)                     the witness entries, in witness order
+//   [nWitness, + nConstants)          constants
+//   [nWitness + nConstants, nValues)  scratch slots
+//
+// and every other value, temporaries and the signals the witness leaves
+// out alike, lives in a scratch slot from its definition to its last read,
+// after which the slot is reused. Slots are taken back most recently freed
+// first, so the few that are hot stay in cache.
+void Circom_Tape::compactMemory(Circom_Circuit *circuit) {
+  uint nWitness = get_size_of_witness();
+  uint nInputs = get_main_input_signal_start() + get_main_input_signal_no();
+  std::vector<u32> position(nValues, NONE);
+  for (u32 i = 0; i < nWitness; i++) {
+    position[circuit->witness2SignalList[i]] = i;
+  }
+  // inputs are set by signal number, and keep it
+  for (u32 s = 0; s < nInputs; s++) {
+    if (position[s] != s) {
+      throw std::runtime_error("Compact memory: the main inputs are not at their own witness positions\n");
+    }
+  }
+  for (u32 k = 0; k < nConstants; k++) {
+    position[nSignals + k] = nWitness + k;
+  }
+
+  std::vector<u32> lastRead(nValues, NONE);
+  for (u32 i = 0; i < ops.size(); i++) {
+    for (uint j = 0; j < nOperands(ops[i].code); j++) lastRead[operand(ops[i], j)] = i;
+  }
+
+  std::vector<u32> freeSlots;
+  u32 nSlots = 0;
+  u32 scratch = nWitness + nConstants;
+  for (u32 i = 0; i < ops.size(); i++) {
+    Circom_TapeOp &op = ops[i];
+    uint n = nOperands(op.code);
+    u32 read[3];
+    for (uint j = 0; j < n; j++) {
+      read[j] = operand(op, j);
+      if (position[read[j]] == NONE) {
+        throw std::runtime_error("Compact memory: a value is read before it is computed\n");
+      }
+      operand(op, j) = position[read[j]];
+    }
+    if (op.code != TAPE_ASSERT) {
+      u32 x = op.dst;
+      if (position[x] == NONE) {
+        if (freeSlots.empty()) freeSlots.push_back(scratch + nSlots++);
+        position[x] = freeSlots.back();
+        freeSlots.pop_back();
+        // never read: the slot is free again right away
+        if (lastRead[x] == NONE) freeSlots.push_back(position[x]);
+      }
+      op.dst = position[x];
+    }
+    // slots read for the last time, freed once the result has its own so
+    // that it never overwrites an operand
+    for (uint j = 0; j < n; j++) {
+      bool repeated = (j > 0 && read[j] == read[0]) || (j > 1 && read[j] == read[1]);
+      if (!repeated && position[read[j]] >= scratch && lastRead[read[j]] == i) {
+        freeSlots.push_back(position[read[j]]);
+      }
+    }
+  }
+
+  nSignals = nWitness;
+  nValues = scratch + nSlots;
+  compacted = true;
+  index();
+
+  // the witness is now stored as is, in one run
+  witness2Signal.resize(nWitness);
+  for (u32 i = 0; i < nWitness; i++) witness2Signal[i] = i;
+  Circom_WitnessRun run = { 0, 0, nWitness };
+  witnessRuns.assign(1, run);
+}
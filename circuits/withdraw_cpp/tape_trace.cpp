@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <iostream>
+#include <assert.h>
+#include "circom.hpp"
+#include "calcwit.hpp"
+#include "tape.hpp"
+
+// The generated templates compiled a second time, in their own namespace,
+// with the field operations going to the tape recorder. Everything
+// withdraw.cpp includes is already included above, so only its own
+// definitions end up in the namespace.
+#define Fr_copy Tape_copy
+#define Fr_add Tape_add
+#define Fr_sub Tape_sub
+#define Fr_mul Tape_mul
+#define Fr_square Tape_square
+#define Fr_neg Tape_neg
+#define Fr_eq Tape_eq
+#define Fr_neq Tape_neq
+#define Fr_lt Tape_lt
+#define Fr_gt Tape_gt
+#define Fr_leq Tape_leq
+#define Fr_geq Tape_geq
+#define Fr_isTrue Tape_isTrue
+#define Fr_toInt Tape_toInt
+#define Circom_assert Tape_assert
+
+namespace circom_trace {
+
+#include "withdraw.cpp"
+
+// MiMC7 has no generated body (see mimc7.cpp)
+void MiMC7_0_run(uint ctx_index, Circom_CalcWit* ctx) {
+  MiMC7_0_record(Tape_recording(), ctx->componentMemory[ctx_index].signalStart);
+}
+
+}
+
+Circom_TemplateFunction *_traceFunctionTable = circom_trace::_functionTable;
+
+void traceRun(Circom_CalcWit *ctx) {
+  circom_trace::run(ctx);
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include "taskpool.hpp"
+
+// worker index of the current thread in the pool it belongs to, if any
+static thread_local Circom_TaskPool *currentPool = NULL;
+static thread_local int currentWorker = -1;
+
+Circom_TaskPool::Circom_TaskPool(uint aNWorkers) {
+  nWorkers = aNWorkers > 0 ? aNWorkers : 1;
+  workers = new Worker[nWorkers];
+  queued = 0;
+  nextWorker = 0;
+  stopping = false;
+  for (uint i = 0; i < nWorkers; i++) {
+    threads.push_back(std::thread(&Circom_TaskPool::workerLoop, this, i));
+  }
+}
+
+Circom_TaskPool::~Circom_TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  sleepCv.notify_all();
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  delete [] workers;
+}
+
+bool Circom_TaskPool::push(uint w, Circom_Task const &task) {
+  Worker &worker = workers[w];
+  std::lock_guard<std::mutex> lock(worker.m);
+  if (worker.tail - worker.head == TASKPOOL_QUEUE_SIZE) return false;
+  worker.tasks[worker.tail % TASKPOOL_QUEUE_SIZE] = task;
+  worker.tail++;
+  return true;
+}
+
+bool Circom_TaskPool::pop(uint w, Circom_Task &task) {
+  Worker &worker = workers[w];
+  std::lock_guard<std::mutex> lock(worker.m);
+  if (worker.tail == worker.head) return false;
+  worker.tail--;
+  task = worker.tasks[worker.tail % TASKPOOL_QUEUE_SIZE];
+  return true;
+}
+
+bool Circom_TaskPool::steal(uint w, Circom_Task &task) {
+  Worker &worker = workers[w];
+  std::lock_guard<std::mutex> lock(worker.m);
+  if (worker.tail == worker.head) return false;
+  task = worker.tasks[worker.head % TASKPOOL_QUEUE_SIZE];
+  worker.head++;
+  return true;
+}
+
+// Own queue first, then the others starting at the next worker
+bool Circom_TaskPool::take(int self, Circom_Task &task) {
+  if (queued.load() == 0) return false;
+  if (self >= 0 && pop(self, task)) {
+    queued--;
+    return true;
+  }
+  uint start = self >= 0 ? self + 1 : 0;
+  for (uint i = 0; i < nWorkers; i++) {
+    uint w = (start + i) % nWorkers;
+    if ((int)w != self && steal(w, task)) {
+      queued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Circom_TaskPool::execute(Circom_Task &task) {
+  try {
+    if (task.fn != NULL) {
+      task.fn(task.cIdx, task.ctx);
+    } else {
+      task.job(task.arg, task.cIdx);
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (!task.group->error) task.group->error = std::current_exception();
+  }
+  // publishes the error too
+  task.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void Circom_TaskPool::workerLoop(uint w) {
+  currentPool = this;
+  currentWorker = w;
+  Circom_Task task;
+  for (;;) {
+    if (take(w, task)) {
+      execute(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepCv.wait(lock, [this] { return stopping || queued.load() > 0; });
+    if (stopping) return;
+  }
+}
+
+void Circom_TaskPool::submit(Circom_TaskFunction fn, uint cIdx, Circom_CalcWit *ctx, Circom_TaskGroup *group) {
+  Circom_Task task = { fn, cIdx, ctx, NULL, NULL, group };
+  enqueue(task);
+}
+
+void Circom_TaskPool::submit(Circom_JobFunction job, void *arg, uint idx, Circom_TaskGroup *group) {
+  Circom_Task task = { NULL, idx, NULL, job, arg, group };
+  enqueue(task);
+}
+
+void Circom_TaskPool::enqueue(Circom_Task &task) {
+  task.group->pending.fetch_add(1);
+  uint w = currentPool == this ? currentWorker : nextWorker++ % nWorkers;
+  queued++;
+  if (!push(w, task)) {
+    queued--;
+    execute(task);  // queue full: run it here
+    return;
+  }
+  {
+    // taken so that a worker cannot miss the notification between checking
+    // queued and going to sleep
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+  sleepCv.notify_one();
+}
+
+void Circom_TaskPool::wait(Circom_TaskGroup *group) {
+  int self = currentPool == this ? currentWorker : -1;
+  Circom_Task task;
+  while (group->pending.load(std::memory_order_acquire) != 0) {
+    if (take(self, task)) {
+      execute(task);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  if (group->error) {
+    std::exception_ptr error = group->error;
+    group->error = NULL;
+    std::rethrow_exception(error);
+  }
+}
+
+Circom_TaskPool *createDefaultTaskPool(uint maxWorkers) {
+  uint n = std::thread::hardware_concurrency();
+  if (n <= 1) return NULL;
+  return new Circom_TaskPool(std::min(n - 1, maxWorkers));
+}
@@ -0,0 +1,90 @@
+#ifndef CIRCOM_TASKPOOL_H
+#define CIRCOM_TASKPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "circom.hpp"
+
+#define TASKPOOL_QUEUE_SIZE 256
+
+class Circom_CalcWit;
+
+typedef void (*Circom_TaskFunction)(uint cIdx, Circom_CalcWit *ctx);
+typedef void (*Circom_JobFunction)(void *arg, uint idx);
+
+// Either a template run function or a plain job, whichever fn is set
+struct Circom_Task {
+  Circom_TaskFunction fn;
+  uint cIdx;
+  Circom_CalcWit *ctx;
+  Circom_JobFunction job;
+  void *arg;
+  Circom_TaskGroup *group;
+};
+
+// Small work-stealing pool used to run independent subcomponents of a
+// witness concurrently. Every worker owns a fixed size queue: it pushes and
+// pops at the back, idle workers steal from the front of the others. A
+// thread waiting for its subcomponents runs queued tasks meanwhile, so
+// nested waits cannot starve the pool. Nothing is allocated per task.
+// A task that throws, such as a failed assert in a subcomponent, does not
+// take its worker down: the exception is kept in its group for the thread
+// that waits for it.
+class Circom_TaskPool {
+
+  struct Worker {
+    std::mutex m;
+    Circom_Task tasks[TASKPOOL_QUEUE_SIZE];
+    uint head = 0;  // oldest task, stolen first
+    uint tail = 0;  // next free slot
+  };
+
+  uint nWorkers;
+  Worker *workers;
+  std::vector<std::thread> threads;
+
+  std::mutex sleepMutex;
+  std::condition_variable sleepCv;
+  std::atomic<uint> queued;
+  std::atomic<uint> nextWorker;
+  bool stopping;
+  std::mutex errorMutex;  // tasks of a group can fail at the same time
+
+  bool push(uint w, Circom_Task const &task);
+  bool pop(uint w, Circom_Task &task);
+  bool steal(uint w, Circom_Task &task);
+  bool take(int self, Circom_Task &task);
+  void execute(Circom_Task &task);
+  void enqueue(Circom_Task &task);
+  void workerLoop(uint w);
+
+public:
+
+  Circom_TaskPool(uint aNWorkers);
+  ~Circom_TaskPool();
+
+  // Runs fn(cIdx, ctx) on the pool. group->pending is incremented now and
+  // decremented once the task has finished.
+  void submit(Circom_TaskFunction fn, uint cIdx, Circom_CalcWit *ctx, Circom_TaskGroup *group);
+
+  // Same for work that is not a template, such as a slice of the .wtns output
+  void submit(Circom_JobFunction job, void *arg, uint idx, Circom_TaskGroup *group);
+
+  // Returns when every task of the group has finished, running queued tasks
+  // while waiting. Rethrows the first exception of the group, if any.
+  void wait(Circom_TaskGroup *group);
+
+  inline uint getNumWorkers() {
+    return nWorkers;
+  }
+};
+
+// One worker per additional hardware thread, at most maxWorkers. NULL on a
+// single core host, where running everything inline is faster.
+Circom_TaskPool *createDefaultTaskPool(uint maxWorkers);
+
+#endif // CIRCOM_TASKPOOL_H
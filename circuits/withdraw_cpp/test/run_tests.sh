@@ -0,0 +1,54 @@
+#!/bin/sh
+# Regression tests, run by `make test` once withdraw and test/test_withdraw
+# are built. The reference witnesses come from the wasm generator of the
+# same circuit (../withdraw_js), which needs node.
+set -e
+cd "$(dirname "$0")/.."
+
+refs=$(mktemp -d)
+trap 'rm -rf "$refs"' EXIT
+
+for i in 0 1 2 3; do
+  node ../withdraw_js/generate_witness.js ../withdraw_js/withdraw.wasm test/inputs/in$i.json "$refs/ref$i.wtns"
+done
+
+failed=0
+check() {
+  if "$@"; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name"
+    failed=1
+  fi
+}
+
+# the command line: a witness, and a failed assert reported as an error
+name="command line witness"
+check eval './withdraw test/inputs/in0.json "$refs/out.wtns" && cmp -s "$refs/out.wtns" "$refs/ref0.wtns"'
+name="command line failed assert"
+check eval '! ./withdraw test/inputs/bad_root.json "$refs/out.wtns" 2>"$refs/err" && grep -q "Withdraw line 33" "$refs/err"'
+# missing inputs and an unwritable output are errors, not aborts
+echo '{}' >"$refs/empty.json"
+name="command line missing inputs"
+check eval './withdraw "$refs/empty.json" "$refs/out.wtns" 2>"$refs/err"; test $? -eq 1 && grep -q "Not all inputs" "$refs/err"'
+name="command line unwritable output"
+check eval './withdraw test/inputs/in0.json "$refs/missing/out.wtns" 2>"$refs/err"; test $? -eq 1 && grep -q "missing/out.wtns" "$refs/err"'
+
+# validation, and an input it cannot read
+name="validate"
+check ./withdraw --validate test/inputs/in0.json
+name="validate failed assert"
+check eval './withdraw --validate test/inputs/bad_root.json 2>"$refs/err"; test $? -eq 1 && grep -q "Withdraw line 33" "$refs/err"'
+name="validate missing input"
+check eval './withdraw --validate "$refs/missing.json" 2>"$refs/err"; test $? -eq 1 && grep -q "missing.json" "$refs/err"'
+
+# Montgomery form is only for the witness files
+name="command line montgomery"
+check eval './withdraw --montgomery test/inputs/in0.json "$refs/out.wtns" && ! cmp -s "$refs/out.wtns" "$refs/ref0.wtns" && ! ./withdraw --montgomery --validate test/inputs/in0.json 2>/dev/null'
+
+# a JSON input that cannot be read is an error
+name="json2bin missing input"
+check eval './withdraw --json2bin "$refs/missing.json" "$refs/out.bin" 2>"$refs/err"; test $? -eq 1 && grep -q "missing.json" "$refs/err"'
+
+./test/test_withdraw "$refs" || failed=1
+exit $failed
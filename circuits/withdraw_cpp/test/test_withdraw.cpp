@@ -0,0 +1,730 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "batch.hpp"
+#include "calcwit.hpp"
+#include "circom.hpp"
+#include "lockstep.hpp"
+#include "server.hpp"
+#include "tape.hpp"
+#include "taskpool.hpp"
+#include "validate.hpp"
+#include "witness_cache.hpp"
+#include "witness_io.hpp"
+
+// Regression tests of the witness generator, run by `make test` from the
+// directory of withdraw.dat, after test/run_tests.sh has computed the
+// reference witnesses of test/inputs/in*.json with the wasm generator.
+//
+//   test_withdraw <reference dir>
+//
+// Every check that fails is reported; the exit status is the number of
+// failed tests.
+
+#define N_VALID_INPUTS 4
+
+static std::string refDir;
+static std::string inputDir = "test/inputs";
+static uint nChecksFailed = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+      nChecksFailed++; \
+    } \
+  } while (0)
+
+static std::vector<u8> readFile(std::string const &path) {
+  MappedFile f(path);
+  return std::vector<u8>(f.data, f.data + f.size);
+}
+
+static std::string validInput(uint i) {
+  return inputDir + "/in" + std::to_string(i) + ".json";
+}
+
+static std::vector<u8> reference(uint i) {
+  return readFile(refDir + "/ref" + std::to_string(i) + ".wtns");
+}
+
+static std::vector<u8> witnessImage(Circom_CalcWit *ctx) {
+  std::vector<u8> image(getBinWitnessSize());
+  buildBinWitness(ctx, image.data());
+  return image;
+}
+
+// The witness of one input file, or the message of what it threw
+static std::vector<u8> computeWitness(Circom_CalcWit *ctx, std::string const &input, std::string &error) {
+  error.clear();
+  try {
+    loadInput(ctx, input);
+    if (ctx->getRemaingInputsToBeSet() != 0) throw std::runtime_error("Not all inputs have been set\n");
+    return witnessImage(ctx);
+  } catch (std::exception &e) {
+    error = e.what();
+    return std::vector<u8>();
+  }
+}
+
+static bool contains(std::string const &s, std::string const &part) {
+  return s.find(part) != std::string::npos;
+}
+
+static std::string tempDir() {
+  char dir[] = "/tmp/test_withdraw.XXXXXX";
+  if (mkdtemp(dir) == NULL) throw std::runtime_error("mkdtemp failed\n");
+  return dir;
+}
+
+/*****************************************************************************************
+ * Template runs
+ *****************************************************************************************/
+
+static void testTemplateWitnesses() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  Circom_CalcWitPool pool(circuit);
+  std::string error;
+  for (uint i = 0; i < N_VALID_INPUTS; i++) {
+    Circom_CalcWit *ctx = pool.acquire();
+    CHECK(computeWitness(ctx, validInput(i), error) == reference(i));
+    CHECK(error.empty());
+    pool.release(ctx);
+  }
+}
+
+// A failed circuit assert is an exception naming the template and line, and
+// leaves a context that computes the next witness right
+static void testTemplateAssert() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  Circom_CalcWitPool pool(circuit);
+  std::string error;
+  Circom_CalcWit *ctx = pool.acquire();
+  CHECK(computeWitness(ctx, inputDir + "/bad_root.json", error).empty());
+  CHECK(contains(error, "Failed assert in template/function Withdraw line 33."));
+  pool.release(ctx);
+  ctx = pool.acquire();
+  CHECK(computeWitness(ctx, inputDir + "/bad_nullifier_hash.json", error).empty());
+  CHECK(contains(error, "Failed assert in template/function Withdraw line 39."));
+  pool.release(ctx);
+  ctx = pool.acquire();
+  CHECK(computeWitness(ctx, validInput(0), error) == reference(0));
+  pool.release(ctx);
+}
+
+// Subcomponents on a pool of several workers, whatever the host has: with
+// one core createDefaultTaskPool gives none and everything runs inline
+static void testParallelTemplates() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  Circom_CalcWitPool pool(circuit, 0, new Circom_TaskPool(3));
+  std::string error;
+  for (uint round = 0; round < 8; round++) {
+    Circom_CalcWit *ctx = pool.acquire();
+    CHECK(ctx->taskPool != NULL && ctx->taskPool->getNumWorkers() == 3);
+    uint i = round % N_VALID_INPUTS;
+    CHECK(computeWitness(ctx, validInput(i), error) == reference(i));
+    pool.release(ctx);
+    // nullifierHasher is still running on a worker when the root is found wrong
+    ctx = pool.acquire();
+    CHECK(computeWitness(ctx, inputDir + "/bad_root.json", error).empty());
+    CHECK(contains(error, "Withdraw line 33"));
+    pool.release(ctx);
+  }
+}
+
+static void failOddTasks(void *arg, uint idx) {
+  if (idx % 2 == 1) throw std::runtime_error("task failed\n");
+  ((std::atomic<u32> *)arg)->fetch_add(1);
+}
+
+// A task that throws leaves the workers running, and its exception comes
+// out of the wait for its group once the whole group has finished
+static void testTaskPoolExceptions() {
+  Circom_TaskPool pool(3);
+  for (uint round = 0; round < 4; round++) {
+    std::atomic<u32> done(0);
+    Circom_TaskGroup group;
+    for (uint i = 0; i < 16; i++) {
+      pool.submit(failOddTasks, &done, i, &group);
+    }
+    std::string error;
+    try {
+      pool.wait(&group);
+    } catch (std::exception &e) {
+      error = e.what();
+    }
+    CHECK(error == "task failed\n");
+    CHECK(done == 8 && group.pending == 0);
+    // the error is only reported once
+    pool.wait(&group);
+  }
+}
+
+// The binary form of each input gives the same witness; a truncated one
+// is an error
+static void testBinInput() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  Circom_CalcWitPool pool(circuit);
+  std::string dir = tempDir(), error;
+  for (uint i = 0; i < N_VALID_INPUTS; i++) {
+    CircomInputs inputs;
+    parseJsonFile(validInput(i), inputs);
+    std::string bin = dir + "/in" + std::to_string(i) + ".bin";
+    writeBinInput(inputs, bin);
+    std::vector<u8> data = readFile(bin);
+    CHECK(isBinInput(data.data(), data.size()));
+    Circom_CalcWit *ctx = pool.acquire();
+    CHECK(computeWitness(ctx, bin, error) == reference(i));
+    CHECK(error.empty());
+    pool.release(ctx);
+  }
+  std::vector<u8> data = readFile(dir + "/in0.bin");
+  FILE *f = fopen((dir + "/truncated.bin").c_str(), "wb");
+  CHECK(f != NULL && fwrite(data.data(), 1, data.size() - 1, f) == data.size() - 1 && fclose(f) == 0);
+  Circom_CalcWit *ctx = pool.acquire();
+  CHECK(computeWitness(ctx, dir + "/truncated.bin", error).empty());
+  CHECK(!error.empty());
+  pool.release(ctx);
+}
+
+/*****************************************************************************************
+ * Tape
+ *****************************************************************************************/
+
+static Circom_Circuit *loadTapeCircuit() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  circuit->tape = Circom_Tape::record(circuit);
+  circuit->tape->optimize(circuit);
+  return circuit;
+}
+
+static void testTapeWitnesses() {
+  Circom_Circuit *circuit = loadTapeCircuit();
+  Circom_CalcWitPool pool(circuit);
+  std::string error;
+  for (uint i = 0; i < N_VALID_INPUTS; i++) {
+    Circom_CalcWit *ctx = pool.acquire();
+    CHECK(computeWitness(ctx, validInput(i), error) == reference(i));
+    CHECK(error.empty());
+    pool.release(ctx);
+  }
+}
+
+// The same messages as the templates give, not the tape position
+static void testTapeAssert() {
+  Circom_Circuit *circuit = loadTapeCircuit();
+  Circom_CalcWitPool pool(circuit);
+  std::string error;
+  Circom_CalcWit *ctx = pool.acquire();
+  CHECK(computeWitness(ctx, inputDir + "/bad_root.json", error).empty());
+  CHECK(error == "Failed assert in template/function Withdraw line 33. Followed trace of components: main\n");
+  pool.release(ctx);
+  ctx = pool.acquire();
+  CHECK(computeWitness(ctx, inputDir + "/bad_nullifier_hash.json", error).empty());
+  CHECK(error == "Failed assert in template/function Withdraw line 39. Followed trace of components: main\n");
+  pool.release(ctx);
+}
+
+// Contexts hold only the witness; the circuit's own tables stay as loaded
+static void testCompactMemory() {
+  Circom_Circuit *circuit = loadTapeCircuit();
+  const u64 *witness2SignalList = circuit->witness2SignalList;
+  std::vector<Circom_WitnessRun> witnessRuns = circuit->witnessRuns;
+  circuit->tape->compactMemory(circuit);
+  CHECK(circuit->tape->nSignals == get_size_of_witness());
+  CHECK(circuit->witness2SignalList == witness2SignalList);
+  CHECK(circuit->witnessRuns.size() == witnessRuns.size());
+  Circom_CalcWitPool pool(circuit);
+  std::string error;
+  for (uint i = 0; i < N_VALID_INPUTS; i++) {
+    Circom_CalcWit *ctx = pool.acquire();
+    CHECK(computeWitness(ctx, validInput(i), error) == reference(i));
+    pool.release(ctx);
+  }
+  Circom_CalcWit *ctx = pool.acquire();
+  CHECK(computeWitness(ctx, inputDir + "/bad_root.json", error).empty());
+  CHECK(contains(error, "Withdraw line 33"));
+  pool.release(ctx);
+}
+
+// Inputs evaluated as they are set give the same witnesses, and the same
+// messages when an assert fails before the last one
+static void testProgressiveTape() {
+  Circom_Circuit *circuit = loadTapeCircuit();
+  Circom_CalcWitPool pool(circuit);
+  std::string error;
+  for (uint i = 0; i < N_VALID_INPUTS; i++) {
+    Circom_CalcWit *ctx = pool.acquire();
+    ctx->progressive = true;
+    CHECK(computeWitness(ctx, validInput(i), error) == reference(i));
+    CHECK(error.empty());
+    pool.release(ctx);
+  }
+  Circom_CalcWit *ctx = pool.acquire();
+  ctx->progressive = true;
+  CHECK(computeWitness(ctx, inputDir + "/bad_root.json", error).empty());
+  CHECK(error == "Failed assert in template/function Withdraw line 33. Followed trace of components: main\n");
+  pool.release(ctx);
+  ctx = pool.acquire();
+  ctx->progressive = true;
+  CHECK(computeWitness(ctx, inputDir + "/bad_nullifier_hash.json", error).empty());
+  CHECK(error == "Failed assert in template/function Withdraw line 39. Followed trace of components: main\n");
+  pool.release(ctx);
+  ctx = pool.acquire();
+  ctx->progressive = true;
+  CHECK(computeWitness(ctx, validInput(0), error) == reference(0));
+  ctx->runOnInputs = false;
+  pool.release(ctx);
+  // released contexts keep no per-request settings
+  ctx = pool.acquire();
+  CHECK(!ctx->progressive && ctx->runOnInputs);
+  pool.release(ctx);
+}
+
+/*****************************************************************************************
+ * Recomputation
+ *****************************************************************************************/
+
+static CircomInputs parseInputs(std::string const &input) {
+  CircomInputs inputs;
+  parseJsonFile(input, inputs);
+  return inputs;
+}
+
+static InputSignalValues &signalNamed(CircomInputs &inputs, std::string const &name) {
+  for (InputSignalValues &in : inputs) {
+    if (in.name == name) return in;
+  }
+  throw std::runtime_error("no input " + name + "\n");
+}
+
+static void updateInputs(Circom_CalcWit *ctx, CircomInputs &inputs) {
+  for (InputSignalValues &in : inputs) {
+    for (uint i = 0; i < in.values.size(); i++) ctx->updateInputSignal(in.h, i, in.values[i]);
+  }
+}
+
+// A witness brought up to date after some inputs, then all of them,
+// changed is the one of the new inputs
+static void checkRecompute(Circom_Circuit *circuit) {
+  Circom_CalcWitPool pool(circuit);
+  std::string error;
+  Circom_CalcWit *ctx = pool.acquire();
+  CHECK(computeWitness(ctx, validInput(0), error) == reference(0));
+
+  // only the recipient: what the witness of in0 with it is, computed anew
+  CircomInputs inputs = parseInputs(validInput(0));
+  CircomInputs other = parseInputs(validInput(1));
+  signalNamed(inputs, "recipient").values = signalNamed(other, "recipient").values;
+  Circom_CalcWit *full = pool.acquire();
+  setInputs(full, inputs);
+  std::vector<u8> expected = witnessImage(full);
+  pool.release(full);
+  updateInputs(ctx, inputs);
+  ctx->recompute();
+  CHECK(witnessImage(ctx) == expected);
+
+  updateInputs(ctx, other);
+  ctx->recompute();
+  CHECK(witnessImage(ctx) == reference(1));
+
+  CircomInputs bad = parseInputs(inputDir + "/bad_root.json");
+  updateInputs(ctx, bad);
+  try {
+    ctx->recompute();
+    CHECK(false);
+  } catch (Circom_AssertError &e) {
+    CHECK(contains(e.what(), "Withdraw line 33"));
+  }
+  pool.release(ctx);
+}
+
+static void testTemplateRecompute() {
+  checkRecompute(loadCircuit("withdraw.dat"));
+}
+
+static void testTapeRecompute() {
+  checkRecompute(loadTapeCircuit());
+}
+
+/*****************************************************************************************
+ * Server
+ *****************************************************************************************/
+
+struct ServerReply {
+  u32 status;
+  std::vector<u8> body;
+};
+
+static bool readFully(int fd, void *buf, size_t size) {
+  char *p = (char *)buf;
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static int connectServer(std::string const &path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  for (uint attempt = 0; attempt < 500; attempt++) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) return fd;
+    close(fd);
+    usleep(10000);
+  }
+  throw std::runtime_error("cannot connect to the test server\n");
+}
+
+// Starts a socket server on its own thread, for the rest of the process,
+// and connects to it
+static int startServer(Circom_Circuit *circuit, std::string const &path, Circom_WitnessCache *cache = NULL, uint maxConnections = SERVER_MAX_CONNECTIONS) {
+  std::thread([circuit, path, cache, maxConnections]() { runSocketServer(circuit, path, cache, maxConnections); }).detach();
+  return connectServer(path);
+}
+
+// true if fd has something to read within timeoutMs
+static bool readable(int fd, int timeoutMs) {
+  struct pollfd p = { fd, POLLIN, 0 };
+  return poll(&p, 1, timeoutMs) == 1;
+}
+
+static ServerReply request(int fd, std::vector<u8> const &data) {
+  ServerReply reply = { ~0u };
+  u32 len = data.size();
+  u32 header[2];
+  if (write(fd, &len, 4) != 4 || write(fd, data.data(), len) != (ssize_t)len) return reply;
+  if (!readFully(fd, header, 8)) return reply;
+  reply.body.resize(header[1]);
+  if (!readFully(fd, reply.body.data(), header[1])) return reply;
+  reply.status = header[0];
+  return reply;
+}
+
+// Bad requests get an error reply and the server goes on serving
+static void testServer() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  int fd = startServer(circuit, tempDir() + "/server.sock");
+  ServerReply r = request(fd, readFile(validInput(0)));
+  CHECK(r.status == SERVER_STATUS_OK && r.body == reference(0));
+  r = request(fd, readFile(inputDir + "/bad_root.json"));
+  CHECK(r.status == SERVER_STATUS_ERROR);
+  CHECK(contains(std::string(r.body.begin(), r.body.end()), "Withdraw line 33"));
+  std::string notJson = "{\"root\": ";
+  r = request(fd, std::vector<u8>(notJson.begin(), notJson.end()));
+  CHECK(r.status == SERVER_STATUS_ERROR);
+  r = request(fd, readFile(validInput(1)));
+  CHECK(r.status == SERVER_STATUS_OK && r.body == reference(1));
+  close(fd);
+}
+
+static ServerReply validateRequest(int fd, std::string const &input) {
+  std::vector<u8> data(SERVER_VALIDATE_PREFIX, SERVER_VALIDATE_PREFIX + 4);
+  std::vector<u8> doc = readFile(input);
+  data.insert(data.end(), doc.begin(), doc.end());
+  return request(fd, data);
+}
+
+static u32 validationStatus(ServerReply const &r) {
+  u32 status = ~0u;
+  if (r.status == SERVER_STATUS_OK && r.body.size() >= 4) memcpy(&status, r.body.data(), 4);
+  return status;
+}
+
+// Validation requests answer with the status and message of validateWithdraw
+static void testServerValidate() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  int fd = startServer(circuit, tempDir() + "/server.sock");
+  ServerReply r = validateRequest(fd, validInput(0));
+  CHECK(validationStatus(r) == VALIDATION_OK && r.body.size() == 4);
+  r = validateRequest(fd, inputDir + "/bad_root.json");
+  CHECK(validationStatus(r) == VALIDATION_BAD_ROOT);
+  CHECK(contains(std::string(r.body.begin() + 4, r.body.end()), "Withdraw line 33"));
+  r = validateRequest(fd, inputDir + "/bad_nullifier_hash.json");
+  CHECK(validationStatus(r) == VALIDATION_BAD_NULLIFIER_HASH);
+  std::string notJson = SERVER_VALIDATE_PREFIX "{\"root\": ";
+  r = request(fd, std::vector<u8>(notJson.begin(), notJson.end()));
+  CHECK(r.status == SERVER_STATUS_ERROR);
+  r = request(fd, readFile(validInput(0)));
+  CHECK(r.status == SERVER_STATUS_OK && r.body == reference(0));
+  close(fd);
+}
+
+// A connection over the limit waits until one of the served ones closes
+static void testServerConnectionLimit() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  std::string path = tempDir() + "/server.sock";
+  int first = startServer(circuit, path, NULL, 1);
+  CHECK(request(first, readFile(validInput(0))).status == SERVER_STATUS_OK);
+  int second = connectServer(path);
+  std::vector<u8> input = readFile(validInput(1));
+  u32 len = input.size();
+  CHECK(write(second, &len, 4) == 4 && write(second, input.data(), len) == (ssize_t)len);
+  CHECK(!readable(second, 200));
+  close(first);
+  CHECK(readable(second, 5000));
+  u32 header[2];
+  CHECK(readFully(second, header, 8) && header[0] == SERVER_STATUS_OK);
+  close(second);
+}
+
+static std::vector<u8> canonicalInputs(Circom_Circuit *circuit, std::string const &input) {
+  Circom_CalcWit ctx(circuit);
+  ctx.runOnInputs = false;
+  loadInput(&ctx, input);
+  std::vector<u8> inputs;
+  Circom_WitnessCache::canonicalInputs(&ctx, inputs);
+  return inputs;
+}
+
+static bool cached(Circom_WitnessCache &cache, std::vector<u8> const &inputs) {
+  off_t offset;
+  u64 size;
+  int fd = cache.lookup(inputs, offset, size);
+  if (fd != -1) close(fd);
+  return fd != -1;
+}
+
+// A JSON request and its binary form share one entry, which a restart
+// keeps and a redeployed circuit does not see
+static void testServerCache() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  std::string dir = tempDir();
+  Circom_WitnessCache *cache = new Circom_WitnessCache(dir, 1 << 20, circuit);
+  int fd = startServer(circuit, dir + "/server.sock", cache);
+  CircomInputs inputs;
+  parseJsonFile(validInput(0), inputs);
+  writeBinInput(inputs, dir + "/in0.bin");
+  for (uint round = 0; round < 2; round++) {
+    ServerReply r = request(fd, readFile(validInput(0)));
+    CHECK(r.status == SERVER_STATUS_OK && r.body == reference(0));
+    r = request(fd, readFile(dir + "/in0.bin"));
+    CHECK(r.status == SERVER_STATUS_OK && r.body == reference(0));
+  }
+  ServerReply r = request(fd, readFile(inputDir + "/bad_root.json"));
+  CHECK(r.status == SERVER_STATUS_ERROR);
+  close(fd);
+
+  std::vector<u8> in0 = canonicalInputs(circuit, validInput(0));
+  CHECK(cached(*cache, in0));
+  CHECK(!cached(*cache, canonicalInputs(circuit, inputDir + "/bad_root.json")));
+  Circom_WitnessCache restarted(dir, 1 << 20, circuit);
+  CHECK(cached(restarted, in0));
+
+  std::vector<u8> image(circuit->image, circuit->image + circuit->imageSize);
+  image.back() ^= 1;
+  Circom_Circuit redeployed = *circuit;
+  redeployed.image = image.data();
+  Circom_WitnessCache stale(dir, 1 << 20, &redeployed);
+  CHECK(!cached(stale, in0));
+}
+
+/*****************************************************************************************
+ * Batch
+ *****************************************************************************************/
+
+static void copyFile(std::string const &from, std::string const &to) {
+  std::vector<u8> data = readFile(from);
+  FILE *f = fopen(to.c_str(), "wb");
+  if (f == NULL || fwrite(data.data(), 1, data.size(), f) != data.size() || fclose(f) != 0) {
+    throw std::runtime_error("cannot write " + to + "\n");
+  }
+}
+
+static bool fileExists(std::string const &path) {
+  return access(path.c_str(), F_OK) == 0;
+}
+
+// A job that fails an assert is reported and skipped, the others written
+static void checkBatch(Circom_Circuit *circuit, bool lockstep) {
+  std::string in = tempDir(), out = tempDir();
+  copyFile(validInput(0), in + "/in0.json");
+  copyFile(inputDir + "/bad_root.json", in + "/bad_root.json");
+  copyFile(validInput(1), in + "/in1.json");
+  copyFile(inputDir + "/bad_nullifier_hash.json", in + "/bad_nullifier_hash.json");
+  CHECK(runBatch(circuit, in, out, lockstep) == EXIT_FAILURE);
+  CHECK(readFile(out + "/in0.wtns") == reference(0));
+  CHECK(readFile(out + "/in1.wtns") == reference(1));
+  CHECK(!fileExists(out + "/bad_root.wtns"));
+  CHECK(!fileExists(out + "/bad_nullifier_hash.wtns"));
+}
+
+// A missing manifest or input directory fails the batch
+static void testBatch() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  checkBatch(circuit, false);
+  CHECK(runBatch(circuit, tempDir() + "/missing", "") == EXIT_FAILURE);
+}
+
+static void testBatchLockstep() {
+  checkBatch(loadCircuit("withdraw.dat"), true);
+}
+
+// Montgomery output: the header of the reference, then x*R mod q for each
+// of its values x
+static bool isMontgomeryOf(std::vector<u8> const &wtns, std::vector<u8> const &ref) {
+  size_t n8 = Fr_N64*8;
+  size_t start = ref.size() - (size_t)get_size_of_witness()*n8;
+  if (wtns.size() != ref.size() || memcmp(wtns.data(), ref.data(), start) != 0) return false;
+  for (size_t off = start; off < ref.size(); off += n8) {
+    FrRawElement m, v;
+    memcpy(m, wtns.data() + off, n8);
+    Fr_rawFromMontgomery(v, m);
+    if (memcmp(v, ref.data() + off, n8) != 0) return false;
+  }
+  return true;
+}
+
+static void testBatchMontgomery() {
+  std::string in = tempDir(), out = tempDir();
+  copyFile(validInput(0), in + "/in0.json");
+  CHECK(runBatch(loadCircuit("withdraw.dat"), in, out, false, true) == EXIT_SUCCESS);
+  std::vector<u8> wtns = readFile(out + "/in0.wtns");
+  CHECK(wtns != reference(0) && isMontgomeryOf(wtns, reference(0)));
+}
+
+/*****************************************************************************************
+ * Lockstep
+ *****************************************************************************************/
+
+// Every lane of a full group and of a partial one, failing lanes next to
+// passing ones
+static void testLockstepLanes() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  Circom_Lockstep engine(circuit);
+  std::vector<std::string> inputs;
+  for (uint w = 0; w < LOCKSTEP_LANES; w++) inputs.push_back(validInput(w % N_VALID_INPUTS));
+  inputs[2] = inputDir + "/bad_root.json";
+  inputs[5] = inputDir + "/bad_nullifier_hash.json";
+  for (uint n : { (uint)LOCKSTEP_LANES, 3u }) {
+    Circom_CalcWit *ctxs[LOCKSTEP_LANES];
+    std::string errors[LOCKSTEP_LANES];
+    for (uint w = 0; w < n; w++) {
+      ctxs[w] = new Circom_CalcWit(circuit);
+      ctxs[w]->runOnInputs = false;
+      loadInput(ctxs[w], inputs[w]);
+    }
+    engine.run(ctxs, n, errors);
+    for (uint w = 0; w < n; w++) {
+      if (w == 2) {
+        CHECK(errors[w] == "Failed assert in template/function Withdraw line 33. Followed trace of components: main\n");
+      } else if (w == 5) {
+        CHECK(errors[w] == "Failed assert in template/function Withdraw line 39. Followed trace of components: main\n");
+      } else {
+        CHECK(errors[w].empty() && witnessImage(ctxs[w]) == reference(w % N_VALID_INPUTS));
+      }
+      delete ctxs[w];
+    }
+  }
+}
+
+/*****************************************************************************************
+ * Validation
+ *****************************************************************************************/
+
+static Circom_Validation validateFile(std::string const &input) {
+  std::vector<u8> data = readFile(input);
+  return validateWithdraw(data.data(), data.size());
+}
+
+// Fails like the witness would, on the same assert, from JSON, binary and
+// parsed inputs alike
+static void testValidation() {
+  Circom_Circuit *circuit = loadCircuit("withdraw.dat");
+  std::string dir = tempDir();
+  for (uint i = 0; i < N_VALID_INPUTS; i++) {
+    Circom_Validation v = validateFile(validInput(i));
+    CHECK(v.status == VALIDATION_OK && v.line == 0 && v.message.empty());
+  }
+  const char *bad[] = { "bad_root.json", "bad_nullifier_hash.json", "both_bad.json" };
+  for (const char *name : bad) {
+    std::string input = inputDir + "/" + name, error;
+    Circom_Validation v = validateFile(input);
+    Circom_CalcWit ctx(circuit);
+    CHECK(computeWitness(&ctx, input, error).empty());
+    CHECK(v.status != VALIDATION_OK && v.message == error);
+    CircomInputs inputs = parseInputs(input);
+    CHECK(validateWithdraw(inputs).message == error);
+    std::string bin = dir + "/" + name + ".bin";
+    writeBinInput(inputs, bin);
+    CHECK(validateFile(bin).message == error);
+  }
+  CHECK(validateFile(inputDir + "/both_bad.json").line == 33);
+
+  CircomInputs inputs = parseInputs(validInput(0));
+  inputs.pop_back();
+  std::string error;
+  try {
+    validateWithdraw(inputs);
+  } catch (std::exception &e) {
+    error = e.what();
+  }
+  CHECK(error == "Not all inputs have been set\n");
+}
+
+/*****************************************************************************************/
+
+struct Test {
+  const char *name;
+  void (*run)();
+};
+
+static const Test tests[] = {
+  { "template witnesses", testTemplateWitnesses },
+  { "template asserts", testTemplateAssert },
+  { "parallel templates", testParallelTemplates },
+  { "task pool exceptions", testTaskPoolExceptions },
+  { "binary input", testBinInput },
+  { "tape witnesses", testTapeWitnesses },
+  { "tape asserts", testTapeAssert },
+  { "compact memory", testCompactMemory },
+  { "progressive tape", testProgressiveTape },
+  { "template recompute", testTemplateRecompute },
+  { "tape recompute", testTapeRecompute },
+  { "server", testServer },
+  { "server connection limit", testServerConnectionLimit },
+  { "server validate", testServerValidate },
+  { "server cache", testServerCache },
+  { "batch", testBatch },
+  { "batch lockstep", testBatchLockstep },
+  { "batch montgomery", testBatchMontgomery },
+  { "lockstep lanes", testLockstepLanes },
+  { "validation", testValidation },
+};
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <reference dir>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  refDir = argv[1];
+  int nFailed = 0;
+  for (const Test &t : tests) {
+    uint before = nChecksFailed;
+    try {
+      t.run();
+    } catch (std::exception &e) {
+      std::cerr << t.name << ": " << e.what() << std::endl;
+      nChecksFailed++;
+    }
+    bool passed = nChecksFailed == before;
+    std::cout << (passed ? "PASS " : "FAIL ") << t.name << std::endl;
+    if (!passed) nFailed++;
+  }
+  return nFailed;
+}
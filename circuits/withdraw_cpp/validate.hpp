@@ -0,0 +1,41 @@
+#ifndef CIRCOM_VALIDATE_H
+#define CIRCOM_VALIDATE_H
+
+#include <string>
+
+#include "circom.hpp"
+#include "fr.hpp"
+#include "witness_io.hpp"
+
+// Admission check for withdraw requests: recomputes the nullifier hash and
+// the Merkle root from the inputs alone, with the raw MiMC7 rounds and no
+// signal stored, and reports which of the two asserts of Withdraw the
+// witness would fail, the root's when both are wrong, as Withdraw checks it
+// first. Costs the 43 permutations of the circuit but none of its 16007
+// signals, and needs no context.
+
+enum Circom_ValidationStatus {
+  VALIDATION_OK = 0,
+  VALIDATION_BAD_ROOT,            // tree.root === root, circom line 33
+  VALIDATION_BAD_NULLIFIER_HASH   // nullifierHasher.out === nullifierHash, line 39
+};
+
+struct Circom_Validation {
+  Circom_ValidationStatus status;
+  uint line;              // circom line of the failing assert, 0 when none
+  std::string message;    // what the circuit prints for it, empty when none
+  // computed values, in Montgomery form
+  RawFr::Element nullifierHash;
+  RawFr::Element root;
+};
+
+// Inputs that are malformed, or do not set every main input, throw
+// std::runtime_error with the message the witness generator gives them.
+Circom_Validation validateWithdraw(CircomInputs const &inputs);
+// A binary input, or a JSON one, told apart as loadInput does
+Circom_Validation validateWithdraw(const void *input, size_t size);
+
+// MiMC7(91) of x with key k, all in Montgomery form (mimc7.cpp)
+void MiMC7_0_hash(FrRawElement out, const FrRawElement x, const FrRawElement k);
+
+#endif // CIRCOM_VALIDATE_H
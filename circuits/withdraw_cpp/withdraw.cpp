@@ -1,19 +1,21 @@
+// Generated by circom, then edited by hand: see the Makefile before
+// regenerating it
 #include <stdio.h>
 #include <iostream>
 #include <assert.h>
 #include "circom.hpp"
 #include "calcwit.hpp"
-void MiMC7_0_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather);
+void MiMC7_0_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather);
 void MiMC7_0_run(uint ctx_index,Circom_CalcWit* ctx);
-void MultiMiMC7_1_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather);
+void MultiMiMC7_1_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather);
 void MultiMiMC7_1_run(uint ctx_index,Circom_CalcWit* ctx);
-void Commitment_2_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather);
+void Commitment_2_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather);
 void Commitment_2_run(uint ctx_index,Circom_CalcWit* ctx);
-void MerkleTreeChecker_3_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather);
+void MerkleTreeChecker_3_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather);
 void MerkleTreeChecker_3_run(uint ctx_index,Circom_CalcWit* ctx);
-void MultiMiMC7_4_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather);
+void MultiMiMC7_4_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather);
 void MultiMiMC7_4_run(uint ctx_index,Circom_CalcWit* ctx);
-void Withdraw_5_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather);
+void Withdraw_5_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather);
 void Withdraw_5_run(uint ctx_index,Circom_CalcWit* ctx);
 Circom_TemplateFunction _functionTable[6] = { 
 MiMC7_0_run,
@@ -22,1297 +24,146 @@ Commitment_2_run,
 MerkleTreeChecker_3_run,
 MultiMiMC7_4_run,
 Withdraw_5_run };
+// Hand schedule for this circuit, which circom does not produce: the
+// nullifierHasher (MultiMiMC7_4) only reads the nullifier, so Withdraw_5_run
+// starts it with runSubcomponent, computes the commitment and the Merkle root
+// meanwhile and joins it with waitSubcomponents before its first assert.
+// Another circuit needs its own entries and calls; they could instead be
+// derived from the component graph, as the subcomponents whose inputs do not
+// depend on the outputs of their siblings.
 Circom_TemplateFunction _functionTableParallel[6] = { 
 NULL,
 NULL,
 NULL,
 NULL,
-NULL,
-NULL };
-uint get_main_input_signal_start() {return 1;}
-
-uint get_main_input_signal_no() {return 47;}
-
-uint get_total_signal_no() {return 16007;}
-
-uint get_number_of_components() {return 68;}
-
-uint get_size_of_input_hashmap() {return 256;}
-
-uint get_size_of_witness() {return 15784;}
-
-uint get_size_of_constants() {return 182;}
-
-uint get_size_of_io_map() {return 0;}
-
-uint get_size_of_bus_field_map() {return 0;}
-
-void release_memory_component(Circom_CalcWit* ctx, uint pos) {{
-
-if (pos != 0){{
-
-if(ctx->componentMemory[pos].subcomponents)
-delete []ctx->componentMemory[pos].subcomponents;
-
-if(ctx->componentMemory[pos].subcomponentsParallel)
-delete []ctx->componentMemory[pos].subcomponentsParallel;
-
-if(ctx->componentMemory[pos].outputIsSet)
-delete []ctx->componentMemory[pos].outputIsSet;
-
-if(ctx->componentMemory[pos].mutexes)
-delete []ctx->componentMemory[pos].mutexes;
-
-if(ctx->componentMemory[pos].cvs)
-delete []ctx->componentMemory[pos].cvs;
-
-if(ctx->componentMemory[pos].sbct)
-delete []ctx->componentMemory[pos].sbct;
-
-}}
-
-
-}}
-
-
-// function declarations
-// template declarations
-void MiMC7_0_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather){
-ctx->componentMemory[coffset].templateId = 0;
-ctx->componentMemory[coffset].templateName = "MiMC7";
-ctx->componentMemory[coffset].signalStart = soffset;
-ctx->componentMemory[coffset].inputCounter = 2;
-ctx->componentMemory[coffset].componentName = componentName;
-ctx->componentMemory[coffset].idFather = componentFather;
-ctx->componentMemory[coffset].subcomponents = new uint[0];
-}
-
-void MiMC7_0_run(uint ctx_index,Circom_CalcWit* ctx){
-FrElement* circuitConstants = ctx->circuitConstants;
-FrElement* signalValues = ctx->signalValues;
-FrElement expaux[4];
-FrElement lvar[94];
-u64 mySignalStart = ctx->componentMemory[ctx_index].signalStart;
-std::string myTemplateName = ctx->componentMemory[ctx_index].templateName;
-std::string myComponentName = ctx->componentMemory[ctx_index].componentName;
-u64 myFather = ctx->componentMemory[ctx_index].idFather;
-u64 myId = ctx_index;
-u32* mySubcomponents = ctx->componentMemory[ctx_index].subcomponents;
-bool* mySubcomponentsParallel = ctx->componentMemory[ctx_index].subcomponentsParallel;
-std::string* listOfTemplateMessages = ctx->listOfTemplateMessages;
-uint sub_component_aux;
-uint index_multiple_eq;
-int cmp_index_ref_load = -1;
-{
-PFrElement aux_dest = &lvar[0];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[0]);
-}
-{
-PFrElement aux_dest = &lvar[1];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[2];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[3];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[4];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[5];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[6];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[7];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[8];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[9];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[10];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[11];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[12];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[13];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[14];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[15];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[16];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[17];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[18];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[19];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[20];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[21];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[22];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[23];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[24];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[25];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[26];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[27];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[28];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[29];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[30];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[31];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[32];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[33];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[34];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[35];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[36];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[37];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[38];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[39];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[40];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[41];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[42];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[43];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[44];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[45];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[46];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[47];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[48];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[49];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[50];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[51];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[52];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[53];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[54];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[55];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[56];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[57];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[58];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[59];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[60];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[61];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[62];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[63];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[64];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[65];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[66];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[67];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[68];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[69];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[70];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[71];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[72];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[73];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[74];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[75];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[76];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[77];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[78];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[79];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[80];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[81];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[82];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[83];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[84];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[85];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[86];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[87];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[88];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[89];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[90];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[91];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[1];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-{
-PFrElement aux_dest = &lvar[2];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[92]);
-}
-{
-PFrElement aux_dest = &lvar[3];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[93]);
-}
-{
-PFrElement aux_dest = &lvar[4];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[94]);
-}
-{
-PFrElement aux_dest = &lvar[5];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[95]);
-}
-{
-PFrElement aux_dest = &lvar[6];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[96]);
-}
-{
-PFrElement aux_dest = &lvar[7];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[97]);
-}
-{
-PFrElement aux_dest = &lvar[8];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[98]);
-}
-{
-PFrElement aux_dest = &lvar[9];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[99]);
-}
-{
-PFrElement aux_dest = &lvar[10];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[100]);
-}
-{
-PFrElement aux_dest = &lvar[11];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[101]);
-}
-{
-PFrElement aux_dest = &lvar[12];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[102]);
-}
-{
-PFrElement aux_dest = &lvar[13];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[103]);
-}
-{
-PFrElement aux_dest = &lvar[14];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[104]);
-}
-{
-PFrElement aux_dest = &lvar[15];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[105]);
-}
-{
-PFrElement aux_dest = &lvar[16];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[106]);
-}
-{
-PFrElement aux_dest = &lvar[17];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[107]);
-}
-{
-PFrElement aux_dest = &lvar[18];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[108]);
-}
-{
-PFrElement aux_dest = &lvar[19];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[109]);
-}
-{
-PFrElement aux_dest = &lvar[20];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[110]);
-}
-{
-PFrElement aux_dest = &lvar[21];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[111]);
-}
-{
-PFrElement aux_dest = &lvar[22];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[112]);
-}
-{
-PFrElement aux_dest = &lvar[23];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[113]);
-}
-{
-PFrElement aux_dest = &lvar[24];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[114]);
-}
-{
-PFrElement aux_dest = &lvar[25];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[115]);
-}
-{
-PFrElement aux_dest = &lvar[26];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[116]);
-}
-{
-PFrElement aux_dest = &lvar[27];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[117]);
-}
-{
-PFrElement aux_dest = &lvar[28];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[118]);
-}
-{
-PFrElement aux_dest = &lvar[29];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[119]);
-}
-{
-PFrElement aux_dest = &lvar[30];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[120]);
-}
-{
-PFrElement aux_dest = &lvar[31];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[121]);
-}
-{
-PFrElement aux_dest = &lvar[32];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[122]);
-}
-{
-PFrElement aux_dest = &lvar[33];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[123]);
-}
-{
-PFrElement aux_dest = &lvar[34];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[124]);
-}
-{
-PFrElement aux_dest = &lvar[35];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[125]);
-}
-{
-PFrElement aux_dest = &lvar[36];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[126]);
-}
-{
-PFrElement aux_dest = &lvar[37];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[127]);
-}
-{
-PFrElement aux_dest = &lvar[38];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[128]);
-}
-{
-PFrElement aux_dest = &lvar[39];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[129]);
-}
-{
-PFrElement aux_dest = &lvar[40];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[130]);
-}
-{
-PFrElement aux_dest = &lvar[41];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[131]);
-}
-{
-PFrElement aux_dest = &lvar[42];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[132]);
-}
-{
-PFrElement aux_dest = &lvar[43];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[133]);
-}
-{
-PFrElement aux_dest = &lvar[44];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[134]);
-}
-{
-PFrElement aux_dest = &lvar[45];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[135]);
-}
-{
-PFrElement aux_dest = &lvar[46];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[136]);
-}
-{
-PFrElement aux_dest = &lvar[47];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[137]);
-}
-{
-PFrElement aux_dest = &lvar[48];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[138]);
-}
-{
-PFrElement aux_dest = &lvar[49];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[139]);
-}
-{
-PFrElement aux_dest = &lvar[50];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[140]);
-}
-{
-PFrElement aux_dest = &lvar[51];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[141]);
-}
-{
-PFrElement aux_dest = &lvar[52];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[142]);
-}
-{
-PFrElement aux_dest = &lvar[53];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[143]);
-}
-{
-PFrElement aux_dest = &lvar[54];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[144]);
-}
-{
-PFrElement aux_dest = &lvar[55];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[145]);
-}
-{
-PFrElement aux_dest = &lvar[56];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[146]);
-}
-{
-PFrElement aux_dest = &lvar[57];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[147]);
-}
-{
-PFrElement aux_dest = &lvar[58];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[148]);
-}
-{
-PFrElement aux_dest = &lvar[59];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[149]);
-}
-{
-PFrElement aux_dest = &lvar[60];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[150]);
-}
-{
-PFrElement aux_dest = &lvar[61];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[151]);
-}
-{
-PFrElement aux_dest = &lvar[62];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[152]);
-}
-{
-PFrElement aux_dest = &lvar[63];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[153]);
-}
-{
-PFrElement aux_dest = &lvar[64];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[154]);
-}
-{
-PFrElement aux_dest = &lvar[65];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[155]);
-}
-{
-PFrElement aux_dest = &lvar[66];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[156]);
-}
-{
-PFrElement aux_dest = &lvar[67];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[157]);
-}
-{
-PFrElement aux_dest = &lvar[68];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[158]);
-}
-{
-PFrElement aux_dest = &lvar[69];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[159]);
-}
-{
-PFrElement aux_dest = &lvar[70];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[160]);
-}
-{
-PFrElement aux_dest = &lvar[71];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[161]);
-}
-{
-PFrElement aux_dest = &lvar[72];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[162]);
-}
-{
-PFrElement aux_dest = &lvar[73];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[163]);
-}
-{
-PFrElement aux_dest = &lvar[74];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[164]);
-}
-{
-PFrElement aux_dest = &lvar[75];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[165]);
-}
-{
-PFrElement aux_dest = &lvar[76];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[166]);
-}
-{
-PFrElement aux_dest = &lvar[77];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[167]);
-}
-{
-PFrElement aux_dest = &lvar[78];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[168]);
-}
-{
-PFrElement aux_dest = &lvar[79];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[169]);
-}
-{
-PFrElement aux_dest = &lvar[80];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[170]);
-}
-{
-PFrElement aux_dest = &lvar[81];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[171]);
-}
-{
-PFrElement aux_dest = &lvar[82];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[172]);
-}
-{
-PFrElement aux_dest = &lvar[83];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[173]);
-}
-{
-PFrElement aux_dest = &lvar[84];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[174]);
-}
-{
-PFrElement aux_dest = &lvar[85];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[175]);
-}
-{
-PFrElement aux_dest = &lvar[86];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[176]);
-}
-{
-PFrElement aux_dest = &lvar[87];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[177]);
-}
-{
-PFrElement aux_dest = &lvar[88];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[178]);
+MultiMiMC7_4_run,
+NULL };
+uint get_main_input_signal_start() {return 1;}
+
+uint get_main_input_signal_no() {return 47;}
+
+uint get_total_signal_no() {return 16007;}
+
+uint get_number_of_components() {return 68;}
+
+uint get_total_subcomponent_no() {return 67;}
+
+uint get_size_of_input_hashmap() {return 256;}
+
+InputSignalDef _mainInputs[9] = {
+{"root",0xa354fd1ff0c467c5ULL,1,1},
+{"nullifierHash",0x26f05dd05c4f59d5ULL,2,1},
+{"recipient",0x3d0abea328337078ULL,3,1},
+{"relayer",0x14e16fba92b45615ULL,4,1},
+{"fee",0xdcc68b18feeaa3e3ULL,5,1},
+{"nullifier",0xb79e97481b3cb9e9ULL,6,1},
+{"secret",0xab23f0eec020c951ULL,7,1},
+{"pathElements",0x4099e7b711de8b07ULL,8,20},
+{"pathIndices",0x6831dcf79ac686bbULL,28,20} };
+
+// Perfect hash over the main input names: slot MAIN_INPUT_SLOT(fnv1a(name))
+// holds the position of the input in _mainInputs, -1 marks unused slots
+#define MAIN_INPUT_SLOT(h) (((h) >> 11) & 15)
+static const int _mainInputSlots[16] = { 8, 7, -1, -1, 4, -1, -1, 5, -1, 6, 3, 1, 0, -1, 2, -1 };
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("root")) == 12, "root");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("nullifierHash")) == 11, "nullifierHash");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("recipient")) == 14, "recipient");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("relayer")) == 10, "relayer");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("fee")) == 4, "fee");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("nullifier")) == 7, "nullifier");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("secret")) == 9, "secret");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("pathElements")) == 1, "pathElements");
+static_assert(MAIN_INPUT_SLOT(fnv1a_const("pathIndices")) == 0, "pathIndices");
+
+uint get_number_of_main_inputs() {return 9;}
+
+InputSignalDef const *get_main_input_defs() {return _mainInputs;}
+
+int get_main_input_index(u64 h) {
+int idx = _mainInputSlots[MAIN_INPUT_SLOT(h)];
+if (idx < 0 || _mainInputs[idx].hash != h) return -1;
+return idx;
 }
-{
-PFrElement aux_dest = &lvar[89];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[179]);
+
+uint get_size_of_witness() {return 15784;}
+
+uint get_size_of_constants() {return 182;}
+
+uint get_size_of_io_map() {return 0;}
+
+uint get_size_of_bus_field_map() {return 0;}
+
+void release_memory_component(Circom_CalcWit* ctx, uint pos) {{
+
+if (pos != 0){{
+
+if(ctx->componentMemory[pos].subcomponentsParallel){
+delete []ctx->componentMemory[pos].subcomponentsParallel;
+ctx->componentMemory[pos].subcomponentsParallel = NULL;
 }
-{
-PFrElement aux_dest = &lvar[90];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[180]);
+
+if(ctx->componentMemory[pos].outputIsSet){
+delete []ctx->componentMemory[pos].outputIsSet;
+ctx->componentMemory[pos].outputIsSet = NULL;
 }
-{
-PFrElement aux_dest = &lvar[91];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[181]);
+
+if(ctx->componentMemory[pos].mutexes){
+delete []ctx->componentMemory[pos].mutexes;
+ctx->componentMemory[pos].mutexes = NULL;
 }
-{
-PFrElement aux_dest = &lvar[92];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
+
+if(ctx->componentMemory[pos].cvs){
+delete []ctx->componentMemory[pos].cvs;
+ctx->componentMemory[pos].cvs = NULL;
 }
-{
-PFrElement aux_dest = &lvar[93];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
+
+if(ctx->componentMemory[pos].sbct){
+delete []ctx->componentMemory[pos].sbct;
+ctx->componentMemory[pos].sbct = NULL;
 }
-Fr_lt(&expaux[0],&lvar[93],&circuitConstants[0]); // line circom 126
-while(Fr_isTrue(&expaux[0])){
-{{
-Fr_eq(&expaux[0],&lvar[93],&circuitConstants[1]); // line circom 127
+
 }}
-if(Fr_isTrue(&expaux[0])){
-{
-PFrElement aux_dest = &lvar[92];
-// load src
-Fr_add(&expaux[0],&signalValues[mySignalStart + 2],&signalValues[mySignalStart + 1]); // line circom 127
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-}else{
-{
-PFrElement aux_dest = &lvar[92];
-// load src
-Fr_sub(&expaux[2],&lvar[93],&circuitConstants[2]); // line circom 127
-Fr_add(&expaux[1],&signalValues[mySignalStart + 2],&signalValues[mySignalStart + ((1 * Fr_toInt(&expaux[2])) + 276)]); // line circom 127
-Fr_add(&expaux[0],&expaux[1],&lvar[((1 * Fr_toInt(&lvar[93])) + 1)]); // line circom 127
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-}
-{
-PFrElement aux_dest = &signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 3)];
-// load src
-Fr_mul(&expaux[0],&lvar[92],&lvar[92]); // line circom 128
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-{
-PFrElement aux_dest = &signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 94)];
-// load src
-Fr_mul(&expaux[0],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 3)],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 3)]); // line circom 129
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-{
-PFrElement aux_dest = &signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 185)];
-// load src
-Fr_mul(&expaux[0],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 94)],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 3)]); // line circom 130
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-Fr_lt(&expaux[0],&lvar[93],&circuitConstants[91]); // line circom 131
-if(Fr_isTrue(&expaux[0])){
-{
-PFrElement aux_dest = &signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 276)];
-// load src
-Fr_mul(&expaux[0],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[93])) + 185)],&lvar[92]); // line circom 132
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-}else{
-{
-PFrElement aux_dest = &signalValues[mySignalStart + 0];
-// load src
-Fr_mul(&expaux[1],&signalValues[mySignalStart + 275],&lvar[92]); // line circom 134
-Fr_add(&expaux[0],&expaux[1],&signalValues[mySignalStart + 2]); // line circom 134
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-}
-{
-PFrElement aux_dest = &lvar[93];
-// load src
-Fr_add(&expaux[0],&lvar[93],&circuitConstants[2]); // line circom 126
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-Fr_lt(&expaux[0],&lvar[93],&circuitConstants[0]); // line circom 126
-}
-for (uint i = 0; i < 0; i++){
-uint index_subc = ctx->componentMemory[ctx_index].subcomponents[i];
-if (index_subc != 0){
-assert(!(ctx->componentMemory[index_subc].inputCounter));
-release_memory_component(ctx,index_subc);
-}
-}
+
+
+}}
+
+
+// function declarations
+// template declarations
+void MiMC7_0_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather){
+ctx->componentMemory[coffset].templateId = 0;
+ctx->componentMemory[coffset].templateName = "MiMC7";
+ctx->componentMemory[coffset].signalStart = soffset;
+ctx->componentMemory[coffset].inputCounter = 2;
+ctx->componentMemory[coffset].runningSubcomponents.pending = 0;
+ctx->componentMemory[coffset].componentName = componentName;
+ctx->componentMemory[coffset].nameDimensions = NULL;
+ctx->componentMemory[coffset].idFather = componentFather;
+ctx->componentMemory[coffset].subcomponents = ctx->allocSubcomponents(0);
 }
 
-void MultiMiMC7_1_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather){
+// MiMC7_0_run is implemented natively in mimc7.cpp
+
+void MultiMiMC7_1_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather){
 ctx->componentMemory[coffset].templateId = 1;
 ctx->componentMemory[coffset].templateName = "MultiMiMC7";
 ctx->componentMemory[coffset].signalStart = soffset;
 ctx->componentMemory[coffset].inputCounter = 3;
+ctx->componentMemory[coffset].runningSubcomponents.pending = 0;
 ctx->componentMemory[coffset].componentName = componentName;
+ctx->componentMemory[coffset].nameDimensions = NULL;
 ctx->componentMemory[coffset].idFather = componentFather;
-ctx->componentMemory[coffset].subcomponents = new uint[2]{0};
+ctx->componentMemory[coffset].subcomponents = ctx->allocSubcomponents(2);
 }
 
 void MultiMiMC7_1_run(uint ctx_index,Circom_CalcWit* ctx){
 FrElement* circuitConstants = ctx->circuitConstants;
 FrElement* signalValues = ctx->signalValues;
 FrElement expaux[2];
-FrElement lvar[3];
+FrElement lvar[0];
 u64 mySignalStart = ctx->componentMemory[ctx_index].signalStart;
-std::string myTemplateName = ctx->componentMemory[ctx_index].templateName;
-std::string myComponentName = ctx->componentMemory[ctx_index].componentName;
+const char *myTemplateName = ctx->componentMemory[ctx_index].templateName;
+const char *myComponentName = ctx->componentMemory[ctx_index].componentName;
 u64 myFather = ctx->componentMemory[ctx_index].idFather;
 u64 myId = ctx_index;
 u32* mySubcomponents = ctx->componentMemory[ctx_index].subcomponents;
@@ -1322,25 +173,13 @@ uint sub_component_aux;
 uint index_multiple_eq;
 int cmp_index_ref_load = -1;
 {
-PFrElement aux_dest = &lvar[0];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[3]);
-}
-{
-PFrElement aux_dest = &lvar[1];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[0]);
-}
-{
 uint aux_create = 0;
 int aux_cmp_num = 0+ctx_index+1;
 uint csoffset = mySignalStart+7;
-uint aux_dimensions[1] = {2};
+static uint aux_dimensions[1] = {2};
 for (uint i = 0; i < 2; i++) {
-std::string new_cmp_name = "mims"+ctx->generate_position_array(aux_dimensions, 1, i);
-MiMC7_0_create(csoffset,aux_cmp_num,ctx,new_cmp_name,myId);
+MiMC7_0_create(csoffset,aux_cmp_num,ctx,"mims",myId);
+ctx->componentMemory[aux_cmp_num].setNamePosition(aux_dimensions, 1, i);
 mySubcomponents[aux_create+ i] = aux_cmp_num;
 csoffset += 366 ;
 aux_cmp_num += 1;
@@ -1352,21 +191,15 @@ PFrElement aux_dest = &signalValues[mySignalStart + 4];
 // end load src
 Fr_copy(aux_dest,&signalValues[mySignalStart + 3]);
 }
+// line circom 148, counted natively
+for (u32 i = 0; i < 2; i++){
 {
-PFrElement aux_dest = &lvar[2];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-Fr_lt(&expaux[0],&lvar[2],&circuitConstants[3]); // line circom 148
-while(Fr_isTrue(&expaux[0])){
-{
-uint cmp_index_ref = ((1 * Fr_toInt(&lvar[2])) + 0);
+uint cmp_index_ref = i;
 {
 PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 1];
 // load src
 // end load src
-Fr_copy(aux_dest,&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[2])) + 1)]);
+Fr_copy(aux_dest,&signalValues[mySignalStart + (i + 1)]);
 }
 // run sub component if needed
 if(!(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1)){
@@ -1375,12 +208,12 @@ MiMC7_0_run(mySubcomponents[cmp_index_ref],ctx);
 }
 }
 {
-uint cmp_index_ref = ((1 * Fr_toInt(&lvar[2])) + 0);
+uint cmp_index_ref = i;
 {
 PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 2];
 // load src
 // end load src
-Fr_copy(aux_dest,&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[2])) + 4)]);
+Fr_copy(aux_dest,&signalValues[mySignalStart + (i + 4)]);
 }
 // run sub component if needed
 if(!(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1)){
@@ -1389,23 +222,15 @@ MiMC7_0_run(mySubcomponents[cmp_index_ref],ctx);
 }
 }
 {
-PFrElement aux_dest = &signalValues[mySignalStart + ((1 * (Fr_toInt(&lvar[2]) + 1)) + 4)];
-// load src
-Fr_add(&expaux[1],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[2])) + 4)],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[2])) + 1)]); // line circom 152
-cmp_index_ref_load = ((1 * Fr_toInt(&lvar[2])) + 0);
-cmp_index_ref_load = ((1 * Fr_toInt(&lvar[2])) + 0);
-Fr_add(&expaux[0],&expaux[1],&ctx->signalValues[ctx->componentMemory[mySubcomponents[((1 * Fr_toInt(&lvar[2])) + 0)]].signalStart + 0]); // line circom 152
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-{
-PFrElement aux_dest = &lvar[2];
+PFrElement aux_dest = &signalValues[mySignalStart + ((i + 1) + 4)];
 // load src
-Fr_add(&expaux[0],&lvar[2],&circuitConstants[2]); // line circom 148
+Fr_add(&expaux[1],&signalValues[mySignalStart + (i + 4)],&signalValues[mySignalStart + (i + 1)]); // line circom 152
+cmp_index_ref_load = i;
+cmp_index_ref_load = i;
+Fr_add(&expaux[0],&expaux[1],&ctx->signalValues[ctx->componentMemory[mySubcomponents[i]].signalStart + 0]); // line circom 152
 // end load src
 Fr_copy(aux_dest,&expaux[0]);
 }
-Fr_lt(&expaux[0],&lvar[2],&circuitConstants[3]); // line circom 148
 }
 {
 PFrElement aux_dest = &signalValues[mySignalStart + 0];
@@ -1422,14 +247,16 @@ release_memory_component(ctx,index_subc);
 }
 }
 
-void Commitment_2_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather){
+void Commitment_2_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather){
 ctx->componentMemory[coffset].templateId = 2;
 ctx->componentMemory[coffset].templateName = "Commitment";
 ctx->componentMemory[coffset].signalStart = soffset;
 ctx->componentMemory[coffset].inputCounter = 2;
+ctx->componentMemory[coffset].runningSubcomponents.pending = 0;
 ctx->componentMemory[coffset].componentName = componentName;
+ctx->componentMemory[coffset].nameDimensions = NULL;
 ctx->componentMemory[coffset].idFather = componentFather;
-ctx->componentMemory[coffset].subcomponents = new uint[1]{0};
+ctx->componentMemory[coffset].subcomponents = ctx->allocSubcomponents(1);
 }
 
 void Commitment_2_run(uint ctx_index,Circom_CalcWit* ctx){
@@ -1438,8 +265,8 @@ FrElement* signalValues = ctx->signalValues;
 FrElement expaux[1];
 FrElement lvar[0];
 u64 mySignalStart = ctx->componentMemory[ctx_index].signalStart;
-std::string myTemplateName = ctx->componentMemory[ctx_index].templateName;
-std::string myComponentName = ctx->componentMemory[ctx_index].componentName;
+const char *myTemplateName = ctx->componentMemory[ctx_index].templateName;
+const char *myComponentName = ctx->componentMemory[ctx_index].componentName;
 u64 myFather = ctx->componentMemory[ctx_index].idFather;
 u64 myId = ctx_index;
 u32* mySubcomponents = ctx->componentMemory[ctx_index].subcomponents;
@@ -1449,8 +276,7 @@ uint sub_component_aux;
 uint index_multiple_eq;
 int cmp_index_ref_load = -1;
 {
-std::string new_cmp_name = "hasher";
-MultiMiMC7_1_create(mySignalStart+3,0+ctx_index+1,ctx,new_cmp_name,myId);
+MultiMiMC7_1_create(mySignalStart+3,0+ctx_index+1,ctx,"hasher",myId);
 mySubcomponents[0] = 0+ctx_index+1;
 }
 {
@@ -1507,24 +333,26 @@ release_memory_component(ctx,index_subc);
 }
 }
 
-void MerkleTreeChecker_3_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather){
+void MerkleTreeChecker_3_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather){
 ctx->componentMemory[coffset].templateId = 3;
 ctx->componentMemory[coffset].templateName = "MerkleTreeChecker";
 ctx->componentMemory[coffset].signalStart = soffset;
 ctx->componentMemory[coffset].inputCounter = 41;
+ctx->componentMemory[coffset].runningSubcomponents.pending = 0;
 ctx->componentMemory[coffset].componentName = componentName;
+ctx->componentMemory[coffset].nameDimensions = NULL;
 ctx->componentMemory[coffset].idFather = componentFather;
-ctx->componentMemory[coffset].subcomponents = new uint[20]{0};
+ctx->componentMemory[coffset].subcomponents = ctx->allocSubcomponents(20);
 }
 
 void MerkleTreeChecker_3_run(uint ctx_index,Circom_CalcWit* ctx){
 FrElement* circuitConstants = ctx->circuitConstants;
 FrElement* signalValues = ctx->signalValues;
 FrElement expaux[3];
-FrElement lvar[2];
+FrElement lvar[0];
 u64 mySignalStart = ctx->componentMemory[ctx_index].signalStart;
-std::string myTemplateName = ctx->componentMemory[ctx_index].templateName;
-std::string myComponentName = ctx->componentMemory[ctx_index].componentName;
+const char *myTemplateName = ctx->componentMemory[ctx_index].templateName;
+const char *myComponentName = ctx->componentMemory[ctx_index].componentName;
 u64 myFather = ctx->componentMemory[ctx_index].idFather;
 u64 myId = ctx_index;
 u32* mySubcomponents = ctx->componentMemory[ctx_index].subcomponents;
@@ -1534,19 +362,13 @@ uint sub_component_aux;
 uint index_multiple_eq;
 int cmp_index_ref_load = -1;
 {
-PFrElement aux_dest = &lvar[0];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[21]);
-}
-{
 uint aux_create = 0;
 int aux_cmp_num = 0+ctx_index+1;
 uint csoffset = mySignalStart+63;
-uint aux_dimensions[1] = {20};
+static uint aux_dimensions[1] = {20};
 for (uint i = 0; i < 20; i++) {
-std::string new_cmp_name = "hashers"+ctx->generate_position_array(aux_dimensions, 1, i);
-MultiMiMC7_1_create(csoffset,aux_cmp_num,ctx,new_cmp_name,myId);
+MultiMiMC7_1_create(csoffset,aux_cmp_num,ctx,"hashers",myId);
+ctx->componentMemory[aux_cmp_num].setNamePosition(aux_dimensions, 1, i);
 mySubcomponents[aux_create+ i] = aux_cmp_num;
 csoffset += 739 ;
 aux_cmp_num += 3;
@@ -1558,16 +380,10 @@ PFrElement aux_dest = &signalValues[mySignalStart + 42];
 // end load src
 Fr_copy(aux_dest,&signalValues[mySignalStart + 1]);
 }
+// line circom 15, counted natively
+for (u32 i = 0; i < 20; i++){
 {
-PFrElement aux_dest = &lvar[1];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-Fr_lt(&expaux[0],&lvar[1],&circuitConstants[21]); // line circom 15
-while(Fr_isTrue(&expaux[0])){
-{
-uint cmp_index_ref = ((1 * Fr_toInt(&lvar[1])) + 0);
+uint cmp_index_ref = i;
 {
 PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 3];
 // load src
@@ -1581,13 +397,13 @@ MultiMiMC7_1_run(mySubcomponents[cmp_index_ref],ctx);
 }
 }
 {
-uint cmp_index_ref = ((1 * Fr_toInt(&lvar[1])) + 0);
+uint cmp_index_ref = i;
 {
 PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 1];
 // load src
-Fr_sub(&expaux[2],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 42)],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 2)]); // line circom 29
-Fr_mul(&expaux[1],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 22)],&expaux[2]); // line circom 29
-Fr_sub(&expaux[0],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 42)],&expaux[1]); // line circom 29
+Fr_sub(&expaux[2],&signalValues[mySignalStart + (i + 42)],&signalValues[mySignalStart + (i + 2)]); // line circom 29
+Fr_mul(&expaux[1],&signalValues[mySignalStart + (i + 22)],&expaux[2]); // line circom 29
+Fr_sub(&expaux[0],&signalValues[mySignalStart + (i + 42)],&expaux[1]); // line circom 29
 // end load src
 Fr_copy(aux_dest,&expaux[0]);
 }
@@ -1598,13 +414,13 @@ MultiMiMC7_1_run(mySubcomponents[cmp_index_ref],ctx);
 }
 }
 {
-uint cmp_index_ref = ((1 * Fr_toInt(&lvar[1])) + 0);
+uint cmp_index_ref = i;
 {
 PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 2];
 // load src
-Fr_sub(&expaux[2],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 2)],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 42)]); // line circom 30
-Fr_mul(&expaux[1],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 22)],&expaux[2]); // line circom 30
-Fr_sub(&expaux[0],&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 2)],&expaux[1]); // line circom 30
+Fr_sub(&expaux[2],&signalValues[mySignalStart + (i + 2)],&signalValues[mySignalStart + (i + 42)]); // line circom 30
+Fr_mul(&expaux[1],&signalValues[mySignalStart + (i + 22)],&expaux[2]); // line circom 30
+Fr_sub(&expaux[0],&signalValues[mySignalStart + (i + 2)],&expaux[1]); // line circom 30
 // end load src
 Fr_copy(aux_dest,&expaux[0]);
 }
@@ -1615,21 +431,13 @@ MultiMiMC7_1_run(mySubcomponents[cmp_index_ref],ctx);
 }
 }
 {
-PFrElement aux_dest = &signalValues[mySignalStart + ((1 * (Fr_toInt(&lvar[1]) + 1)) + 42)];
-// load src
-cmp_index_ref_load = ((1 * Fr_toInt(&lvar[1])) + 0);
-cmp_index_ref_load = ((1 * Fr_toInt(&lvar[1])) + 0);
-// end load src
-Fr_copy(aux_dest,&ctx->signalValues[ctx->componentMemory[mySubcomponents[((1 * Fr_toInt(&lvar[1])) + 0)]].signalStart + 0]);
-}
-{
-PFrElement aux_dest = &lvar[1];
+PFrElement aux_dest = &signalValues[mySignalStart + ((i + 1) + 42)];
 // load src
-Fr_add(&expaux[0],&lvar[1],&circuitConstants[2]); // line circom 15
+cmp_index_ref_load = i;
+cmp_index_ref_load = i;
 // end load src
-Fr_copy(aux_dest,&expaux[0]);
+Fr_copy(aux_dest,&ctx->signalValues[ctx->componentMemory[mySubcomponents[i]].signalStart + 0]);
 }
-Fr_lt(&expaux[0],&lvar[1],&circuitConstants[21]); // line circom 15
 }
 {
 PFrElement aux_dest = &signalValues[mySignalStart + 0];
@@ -1646,24 +454,26 @@ release_memory_component(ctx,index_subc);
 }
 }
 
-void MultiMiMC7_4_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather){
+void MultiMiMC7_4_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather){
 ctx->componentMemory[coffset].templateId = 4;
 ctx->componentMemory[coffset].templateName = "MultiMiMC7";
 ctx->componentMemory[coffset].signalStart = soffset;
 ctx->componentMemory[coffset].inputCounter = 2;
+ctx->componentMemory[coffset].runningSubcomponents.pending = 0;
 ctx->componentMemory[coffset].componentName = componentName;
+ctx->componentMemory[coffset].nameDimensions = NULL;
 ctx->componentMemory[coffset].idFather = componentFather;
-ctx->componentMemory[coffset].subcomponents = new uint[1]{0};
+ctx->componentMemory[coffset].subcomponents = ctx->allocSubcomponents(1);
 }
 
 void MultiMiMC7_4_run(uint ctx_index,Circom_CalcWit* ctx){
 FrElement* circuitConstants = ctx->circuitConstants;
 FrElement* signalValues = ctx->signalValues;
 FrElement expaux[2];
-FrElement lvar[3];
+FrElement lvar[0];
 u64 mySignalStart = ctx->componentMemory[ctx_index].signalStart;
-std::string myTemplateName = ctx->componentMemory[ctx_index].templateName;
-std::string myComponentName = ctx->componentMemory[ctx_index].componentName;
+const char *myTemplateName = ctx->componentMemory[ctx_index].templateName;
+const char *myComponentName = ctx->componentMemory[ctx_index].componentName;
 u64 myFather = ctx->componentMemory[ctx_index].idFather;
 u64 myId = ctx_index;
 u32* mySubcomponents = ctx->componentMemory[ctx_index].subcomponents;
@@ -1673,20 +483,7 @@ uint sub_component_aux;
 uint index_multiple_eq;
 int cmp_index_ref_load = -1;
 {
-PFrElement aux_dest = &lvar[0];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[2]);
-}
-{
-PFrElement aux_dest = &lvar[1];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[0]);
-}
-{
-std::string new_cmp_name = "mims";
-MiMC7_0_create(mySignalStart+5,0+ctx_index+1,ctx,new_cmp_name,myId);
+MiMC7_0_create(mySignalStart+5,0+ctx_index+1,ctx,"mims",myId);
 mySubcomponents[0] = 0+ctx_index+1;
 }
 {
@@ -1695,14 +492,8 @@ PFrElement aux_dest = &signalValues[mySignalStart + 3];
 // end load src
 Fr_copy(aux_dest,&signalValues[mySignalStart + 2]);
 }
+// line circom 148, a loop of a single iteration
 {
-PFrElement aux_dest = &lvar[2];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-Fr_lt(&expaux[0],&lvar[2],&circuitConstants[2]); // line circom 148
-while(Fr_isTrue(&expaux[0])){
 {
 uint cmp_index_ref = 0;
 {
@@ -1741,13 +532,6 @@ Fr_add(&expaux[0],&expaux[1],&ctx->signalValues[ctx->componentMemory[mySubcompon
 // end load src
 Fr_copy(aux_dest,&expaux[0]);
 }
-{
-PFrElement aux_dest = &lvar[2];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[2]);
-}
-Fr_lt(&expaux[0],&lvar[2],&circuitConstants[2]); // line circom 148
 }
 {
 PFrElement aux_dest = &signalValues[mySignalStart + 0];
@@ -1764,24 +548,26 @@ release_memory_component(ctx,index_subc);
 }
 }
 
-void Withdraw_5_create(uint soffset,uint coffset,Circom_CalcWit* ctx,std::string componentName,uint componentFather){
+void Withdraw_5_create(uint soffset,uint coffset,Circom_CalcWit* ctx,const char *componentName,uint componentFather){
 ctx->componentMemory[coffset].templateId = 5;
 ctx->componentMemory[coffset].templateName = "Withdraw";
 ctx->componentMemory[coffset].signalStart = soffset;
 ctx->componentMemory[coffset].inputCounter = 47;
+ctx->componentMemory[coffset].runningSubcomponents.pending = 0;
 ctx->componentMemory[coffset].componentName = componentName;
+ctx->componentMemory[coffset].nameDimensions = NULL;
 ctx->componentMemory[coffset].idFather = componentFather;
-ctx->componentMemory[coffset].subcomponents = new uint[3]{0};
+ctx->componentMemory[coffset].subcomponents = ctx->allocSubcomponents(3);
 }
 
 void Withdraw_5_run(uint ctx_index,Circom_CalcWit* ctx){
 FrElement* circuitConstants = ctx->circuitConstants;
 FrElement* signalValues = ctx->signalValues;
 FrElement expaux[2];
-FrElement lvar[2];
+FrElement lvar[0];
 u64 mySignalStart = ctx->componentMemory[ctx_index].signalStart;
-std::string myTemplateName = ctx->componentMemory[ctx_index].templateName;
-std::string myComponentName = ctx->componentMemory[ctx_index].componentName;
+const char *myTemplateName = ctx->componentMemory[ctx_index].templateName;
+const char *myComponentName = ctx->componentMemory[ctx_index].componentName;
 u64 myFather = ctx->componentMemory[ctx_index].idFather;
 u64 myId = ctx_index;
 u32* mySubcomponents = ctx->componentMemory[ctx_index].subcomponents;
@@ -1791,26 +577,43 @@ uint sub_component_aux;
 uint index_multiple_eq;
 int cmp_index_ref_load = -1;
 {
-PFrElement aux_dest = &lvar[0];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[21]);
-}
-{
-std::string new_cmp_name = "commitmentHasher";
-Commitment_2_create(mySignalStart+50,0+ctx_index+1,ctx,new_cmp_name,myId);
+Commitment_2_create(mySignalStart+50,0+ctx_index+1,ctx,"commitmentHasher",myId);
 mySubcomponents[0] = 0+ctx_index+1;
 }
 {
-std::string new_cmp_name = "tree";
-MerkleTreeChecker_3_create(mySignalStart+1163,6+ctx_index+1,ctx,new_cmp_name,myId);
+MerkleTreeChecker_3_create(mySignalStart+1163,6+ctx_index+1,ctx,"tree",myId);
 mySubcomponents[1] = 6+ctx_index+1;
 }
 {
-std::string new_cmp_name = "nullifierHasher";
-MultiMiMC7_4_create(mySignalStart+792,4+ctx_index+1,ctx,new_cmp_name,myId);
+MultiMiMC7_4_create(mySignalStart+792,4+ctx_index+1,ctx,"nullifierHasher",myId);
 mySubcomponents[2] = 4+ctx_index+1;
 }
+// nullifierHasher only depends on main inputs, so it is started first
+{
+uint cmp_index_ref = 2;
+{
+PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 1];
+// load src
+// end load src
+Fr_copy(aux_dest,&signalValues[mySignalStart + 5]);
+}
+// no need to run sub component
+ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1;
+assert(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter > 0);
+}
+{
+uint cmp_index_ref = 2;
+{
+PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 2];
+// load src
+// end load src
+Fr_copy(aux_dest,&circuitConstants[1]);
+}
+// need to run sub component, concurrently with the commitmentHasher -> tree chain
+ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1;
+assert(!(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter));
+ctx->runSubcomponent(ctx_index,mySubcomponents[cmp_index_ref]);
+}
 {
 uint cmp_index_ref = 0;
 {
@@ -1852,21 +655,15 @@ MerkleTreeChecker_3_run(mySubcomponents[cmp_index_ref],ctx);
 
 }
 }
-{
-PFrElement aux_dest = &lvar[1];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-Fr_lt(&expaux[0],&lvar[1],&circuitConstants[21]); // line circom 29
-while(Fr_isTrue(&expaux[0])){
+// line circom 29, counted natively
+for (u32 i = 0; i < 20; i++){
 {
 uint cmp_index_ref = 1;
 {
-PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + ((1 * Fr_toInt(&lvar[1])) + 2)];
+PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + (i + 2)];
 // load src
 // end load src
-Fr_copy(aux_dest,&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 7)]);
+Fr_copy(aux_dest,&signalValues[mySignalStart + (i + 7)]);
 }
 // no need to run sub component
 ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1;
@@ -1875,10 +672,10 @@ assert(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter > 0);
 {
 uint cmp_index_ref = 1;
 {
-PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + ((1 * Fr_toInt(&lvar[1])) + 22)];
+PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + (i + 22)];
 // load src
 // end load src
-Fr_copy(aux_dest,&signalValues[mySignalStart + ((1 * Fr_toInt(&lvar[1])) + 27)]);
+Fr_copy(aux_dest,&signalValues[mySignalStart + (i + 27)]);
 }
 // run sub component if needed
 if(!(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1)){
@@ -1886,48 +683,17 @@ MerkleTreeChecker_3_run(mySubcomponents[cmp_index_ref],ctx);
 
 }
 }
-{
-PFrElement aux_dest = &lvar[1];
-// load src
-Fr_add(&expaux[0],&lvar[1],&circuitConstants[2]); // line circom 29
-// end load src
-Fr_copy(aux_dest,&expaux[0]);
-}
-Fr_lt(&expaux[0],&lvar[1],&circuitConstants[21]); // line circom 29
 }
+// nullifierHasher may still be writing into ctx: joined before any assert
+// can fail
+ctx->waitSubcomponents(ctx_index);
 {
 cmp_index_ref_load = 1;
 cmp_index_ref_load = 1;
 {{
 Fr_eq(&expaux[0],&ctx->signalValues[ctx->componentMemory[mySubcomponents[1]].signalStart + 0],&signalValues[mySignalStart + 0]); // line circom 33
 }}
-if (!Fr_isTrue(&expaux[0])) std::cout << "Failed assert in template/function " << myTemplateName << " line 33. " <<  "Followed trace of components: " << ctx->getTrace(myId) << std::endl;
-assert(Fr_isTrue(&expaux[0]));
-}
-{
-uint cmp_index_ref = 2;
-{
-PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 1];
-// load src
-// end load src
-Fr_copy(aux_dest,&signalValues[mySignalStart + 5]);
-}
-// no need to run sub component
-ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1;
-assert(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter > 0);
-}
-{
-uint cmp_index_ref = 2;
-{
-PFrElement aux_dest = &ctx->signalValues[ctx->componentMemory[mySubcomponents[cmp_index_ref]].signalStart + 2];
-// load src
-// end load src
-Fr_copy(aux_dest,&circuitConstants[1]);
-}
-// need to run sub component
-ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter -= 1;
-assert(!(ctx->componentMemory[mySubcomponents[cmp_index_ref]].inputCounter));
-MultiMiMC7_4_run(mySubcomponents[cmp_index_ref],ctx);
+Circom_assert(ctx,&expaux[0],myTemplateName,33,myId);
 }
 {
 cmp_index_ref_load = 2;
@@ -1935,8 +701,7 @@ cmp_index_ref_load = 2;
 {{
 Fr_eq(&expaux[0],&ctx->signalValues[ctx->componentMemory[mySubcomponents[2]].signalStart + 0],&signalValues[mySignalStart + 1]); // line circom 39
 }}
-if (!Fr_isTrue(&expaux[0])) std::cout << "Failed assert in template/function " << myTemplateName << " line 39. " <<  "Followed trace of components: " << ctx->getTrace(myId) << std::endl;
-assert(Fr_isTrue(&expaux[0]));
+Circom_assert(ctx,&expaux[0],myTemplateName,39,myId);
 }
 {
 PFrElement aux_dest = &signalValues[mySignalStart + 47];
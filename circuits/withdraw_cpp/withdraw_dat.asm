@@ -0,0 +1,11 @@
+; Circuit image linked into the binary (make EMBED_DAT=1), so that no
+; .dat file has to be found and mapped at start up
+
+        global withdraw_dat
+        global withdraw_dat_end
+
+        section .rodata
+        align 64
+withdraw_dat:
+        incbin "withdraw.dat"
+withdraw_dat_end:
@@ -0,0 +1,29 @@
+#ifndef CIRCOM_WITHDRAW_LAYOUT_H
+#define CIRCOM_WITHDRAW_LAYOUT_H
+
+// Absolute signal positions of the components of the withdraw circuit, from
+// the offsets passed to the _create functions in withdraw.cpp, for the code
+// that works on them without the templates (lockstep.cpp, validate.cpp)
+
+#define WITHDRAW_START 1
+#define WITHDRAW_ROOT (WITHDRAW_START + 0)
+#define WITHDRAW_NULLIFIER_HASH (WITHDRAW_START + 1)
+#define WITHDRAW_RECIPIENT (WITHDRAW_START + 2)
+#define WITHDRAW_NULLIFIER (WITHDRAW_START + 5)
+#define WITHDRAW_SECRET (WITHDRAW_START + 6)
+#define WITHDRAW_PATH_ELEMENTS (WITHDRAW_START + 7)
+#define WITHDRAW_PATH_INDICES (WITHDRAW_START + 27)
+#define WITHDRAW_SQUARES (WITHDRAW_START + 47)
+#define COMMITMENT_START (WITHDRAW_START + 50)
+#define NULLIFIER_HASHER_START (WITHDRAW_START + 792)
+#define TREE_START (WITHDRAW_START + 1163)
+#define TREE_LEVELS 20
+
+// MultiMiMC7(n): 0 out, 1..n in, n+1 k, r[n+1], then the MiMC7 components
+#define MULTIMIMC7_MIMS(n) (2*(n) + 3)
+#define MIMC7_SIGNALS 366
+
+// circuitConstants[1] is 0, the k every hasher of the circuit is given
+#define CONSTANT_ZERO 1
+
+#endif // CIRCOM_WITHDRAW_LAYOUT_H
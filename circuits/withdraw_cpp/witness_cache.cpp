@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "witness_cache.hpp"
+#include "witness_io.hpp"
+
+#define WITNESS_CACHE_HEADER_SIZE 24u
+#define WITNESS_CACHE_SUFFIX ".wtnc"
+#define WITNESS_CACHE_TEMP_PREFIX ".tmp"
+
+static u64 dataOffset(u64 inputsSize) {
+  u64 end = WITNESS_CACHE_HEADER_SIZE + inputsSize;
+  return (end + WITNESS_CACHE_PAGE_SIZE - 1) / WITNESS_CACHE_PAGE_SIZE * WITNESS_CACHE_PAGE_SIZE;
+}
+
+// The key of an entry file name, false for any other file
+static bool parseFileName(const char *name, u64 &key) {
+  if (strlen(name) != 16 + strlen(WITNESS_CACHE_SUFFIX) || strcmp(name + 16, WITNESS_CACHE_SUFFIX) != 0) {
+    return false;
+  }
+  key = 0;
+  for (uint i = 0; i < 16; i++) {
+    char c = name[i];
+    uint digit;
+    if (c >= '0' && c <= '9') digit = c - '0';
+    else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+    else return false;
+    key = key << 4 | digit;
+  }
+  return true;
+}
+
+static bool writeFully(int fd, const void *buf, size_t size) {
+  const char *p = (const char *)buf;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool preadFully(int fd, void *buf, size_t size, off_t offset) {
+  char *p = (char *)buf;
+  while (size > 0) {
+    ssize_t n = pread(fd, p, size, offset);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+Circom_WitnessCache::Circom_WitnessCache(std::string const &aDir, u64 aBudget, Circom_Circuit *circuit) {
+  dir = aDir;
+  budget = aBudget;
+  circuitFingerprint = fingerprint(circuit);
+  used = 0;
+
+  struct Found {
+    struct timespec time;
+    Entry entry;
+  };
+  std::vector<Found> found;
+  DIR *d = opendir(dir.c_str());
+  if (d == NULL) {
+    throw std::system_error(errno, std::generic_category(), dir);
+  }
+  struct dirent *de;
+  while ((de = readdir(d)) != NULL) {
+    std::string path = dir + "/" + de->d_name;
+    Found f;
+    if (strncmp(de->d_name, WITNESS_CACHE_TEMP_PREFIX, strlen(WITNESS_CACHE_TEMP_PREFIX)) == 0) {
+      unlink(path.c_str());  // left by a writer that did not finish
+      continue;
+    }
+    struct stat sb;
+    if (!parseFileName(de->d_name, f.entry.key) || stat(path.c_str(), &sb) != 0 || !S_ISREG(sb.st_mode)) {
+      continue;
+    }
+    f.time = sb.st_mtim;
+    f.entry.size = sb.st_size;
+    found.push_back(f);
+  }
+  closedir(d);
+
+  std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+    return a.time.tv_sec != b.time.tv_sec ? a.time.tv_sec > b.time.tv_sec : a.time.tv_nsec > b.time.tv_nsec;
+  });
+  for (Found &f : found) {
+    lru.push_back(f.entry);
+    entries[f.entry.key] = std::prev(lru.end());
+    used += f.entry.size;
+  }
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  evict();
+}
+
+std::string Circom_WitnessCache::fileName(u64 key) {
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", key);
+  return dir + "/" + name + WITNESS_CACHE_SUFFIX;
+}
+
+void Circom_WitnessCache::evict() {
+  while (used > budget && !lru.empty()) {
+    Entry &e = lru.back();
+    unlink(fileName(e.key).c_str());
+    used -= e.size;
+    entries.erase(e.key);
+    lru.pop_back();
+  }
+}
+
+void Circom_WitnessCache::canonicalInputs(Circom_CalcWit *ctx, std::vector<u8> &inputs) {
+  uint n8 = Fr_N64*8;
+  uint first = get_main_input_signal_start();
+  uint n = get_main_input_signal_no();
+  inputs.resize((size_t)n*n8);
+  FrRawElement v;
+  for (uint i = 0; i < n; i++) {
+    Fr_toRawNormal(v, &ctx->signalValues[first + i]);
+    memcpy(&inputs[(size_t)i*n8], v, n8);
+  }
+}
+
+static u64 fnv1a(u64 hash, const u8 *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001B3LL;
+  }
+  return hash;
+}
+
+// The code the witnesses are computed with: the running executable, hashed
+// once. Where it cannot be read, the time this file was compiled.
+static u64 buildFingerprint() {
+  static const u64 hash = []() {
+    try {
+      MappedFile exe("/proc/self/exe");
+      return fnv1a(0xCBF29CE484222325LL, exe.data, exe.size);
+    } catch (std::exception &) {
+      const char *built = __DATE__ " " __TIME__;
+      return fnv1a(0xCBF29CE484222325LL, (const u8 *)built, strlen(built));
+    }
+  }();
+  return hash;
+}
+
+// fnv1a of everything the witnesses are computed from: the .dat image
+// holds the witness map and the constants of the circuit, the executable
+// the code that runs them
+u64 Circom_WitnessCache::fingerprint(Circom_Circuit *circuit) {
+  u64 build = buildFingerprint();
+  u64 hash = fnv1a(0xCBF29CE484222325LL, circuit->image, circuit->imageSize);
+  return fnv1a(hash, (const u8 *)&build, sizeof(build));
+}
+
+// fnv1a, from the fingerprint; collisions only cost a miss, since hits
+// compare the inputs
+u64 Circom_WitnessCache::key(std::vector<u8> const &inputs) {
+  return fnv1a(circuitFingerprint, inputs.data(), inputs.size());
+}
+
+int Circom_WitnessCache::lookup(std::vector<u8> const &inputs, off_t &offset, u64 &size) {
+  u64 k = key(inputs);
+  int fd;
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = entries.find(k);
+    if (it == entries.end()) return -1;
+    lru.splice(lru.begin(), lru, it->second);
+    // opened before an eviction can remove it; unlinking it later is fine
+    fd = open(fileName(k).c_str(), O_RDONLY);
+  }
+  if (fd == -1) return -1;
+
+  u32 header[4];
+  u64 storedFingerprint;
+  std::vector<u8> stored(inputs.size());
+  bool valid = preadFully(fd, header, sizeof(header), 0)
+    && memcmp(header, "cwtc", 4) == 0
+    && header[1] == WITNESS_CACHE_VERSION
+    && header[2] == inputs.size()
+    && preadFully(fd, &storedFingerprint, 8, sizeof(header))
+    && storedFingerprint == circuitFingerprint
+    && preadFully(fd, stored.data(), stored.size(), WITNESS_CACHE_HEADER_SIZE)
+    && stored == inputs;
+  struct stat sb;
+  offset = dataOffset(inputs.size());
+  size = valid ? header[3] : 0;
+  if (!valid || fstat(fd, &sb) != 0 || (u64)sb.st_size != offset + size) {
+    close(fd);
+    return -1;
+  }
+  futimens(fd, NULL);  // keeps the order for the next start
+  return fd;
+}
+
+void Circom_WitnessCache::store(std::vector<u8> const &inputs, const u8 *wtns, u64 size) {
+  u64 offset = dataOffset(inputs.size());
+  if (offset + size > budget || size > 0xFFFFFFFFull) return;
+
+  std::string temp = dir + "/" + WITNESS_CACHE_TEMP_PREFIX + "XXXXXX";
+  int fd = mkstemp(&temp[0]);
+  if (fd == -1) return;
+  std::vector<u8> head(offset, 0);
+  u32 header[4] = { 0, WITNESS_CACHE_VERSION, (u32)inputs.size(), (u32)size };
+  memcpy(header, "cwtc", 4);
+  memcpy(head.data(), header, sizeof(header));
+  memcpy(head.data() + sizeof(header), &circuitFingerprint, 8);
+  memcpy(head.data() + WITNESS_CACHE_HEADER_SIZE, inputs.data(), inputs.size());
+  bool written = writeFully(fd, head.data(), head.size()) && writeFully(fd, wtns, size);
+  if (close(fd) != 0) written = false;
+
+  u64 k = key(inputs);
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  // renamed under the lock, so that the index and the directory agree
+  if (!written || rename(temp.c_str(), fileName(k).c_str()) != 0) {
+    unlink(temp.c_str());
+    return;
+  }
+  auto it = entries.find(k);
+  if (it != entries.end()) {
+    used -= it->second->size;
+    lru.erase(it->second);
+  }
+  Entry e = { k, offset + size };
+  lru.push_front(e);
+  entries[k] = lru.begin();
+  used += e.size;
+  evict();
+}
@@ -0,0 +1,84 @@
+#ifndef CIRCOM_WITNESS_CACHE_H
+#define CIRCOM_WITNESS_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+#include "calcwit.hpp"
+#include "circom.hpp"
+
+/*
+On-disk witness cache, for servers that see the same inputs again (clients
+retrying a request). Witnesses are stored by the hash of their inputs in
+canonical form, the main input signals as n8 byte little endian values in
+signal order, so a JSON request and a binary one with the same values hit
+the same entry. Each entry is one file in the cache directory,
+<16 hex digit key>.wtnc:
+
+  "cwtc" | u32 version | u32 inputs size | u32 .wtns size |
+  u64 circuit fingerprint | inputs
+  zero padding up to the next multiple of WITNESS_CACHE_PAGE_SIZE
+  the .wtns image
+
+The fingerprint is a hash of the circuit image and of the executable,
+which goes into the key too: after the circuit is redeployed, or the
+generator rebuilt (another tape optimizer, element layout or engine), the
+witnesses of the old one are misses, left to age out of the budget. The inputs and the fingerprint are
+compared on every hit, so a hash collision is a miss. The .wtns image
+starts on a page boundary, so that it can be mapped or sent with sendfile
+as is.
+
+Entries are evicted least recently used first once their total size goes
+over the byte budget. The order survives restarts through the file times.
+Files are written under a temporary name and renamed, so readers never see
+a partial entry; every method may be called from several threads.
+*/
+
+// bumped whenever the entries, or the witnesses they hold for the same
+// inputs, change
+#define WITNESS_CACHE_VERSION 3
+#define WITNESS_CACHE_PAGE_SIZE 4096u
+
+class Circom_WitnessCache {
+
+  struct Entry {
+    u64 key;
+    u64 size;  // of the file
+  };
+
+  std::string dir;
+  u64 budget;
+  u64 circuitFingerprint;
+  u64 used;
+  std::mutex cacheMutex;
+  std::list<Entry> lru;  // most recently used first
+  std::unordered_map<u64, std::list<Entry>::iterator> entries;
+
+  std::string fileName(u64 key);
+  void evict();  // cacheMutex held
+
+public:
+
+  // Takes over the entries already in dir, which must exist, for the
+  // witnesses of circuit. Throws std::system_error if it cannot be read.
+  Circom_WitnessCache(std::string const &aDir, u64 aBudget, Circom_Circuit *circuit);
+
+  // Canonical form of the inputs of ctx, all of which must be set
+  static void canonicalInputs(Circom_CalcWit *ctx, std::vector<u8> &inputs);
+  static u64 fingerprint(Circom_Circuit *circuit);
+  u64 key(std::vector<u8> const &inputs);
+
+  // A descriptor of the cached witness of these inputs, whose .wtns image
+  // is the size bytes at offset, or -1 on a miss. The caller closes it.
+  int lookup(std::vector<u8> const &inputs, off_t &offset, u64 &size);
+
+  // Adds the witness of these inputs. Failures to write are not errors:
+  // the entry is simply not cached.
+  void store(std::vector<u8> const &inputs, const u8 *wtns, u64 size);
+};
+
+#endif // CIRCOM_WITNESS_CACHE_H
@@ -0,0 +1,576 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+#include <vector>
+#include <system_error>
+
+using json = nlohmann::json;
+
+#include "calcwit.hpp"
+#include "circom.hpp"
+#include "witness_io.hpp"
+
+
+#define handle_error(msg) \
+           do { perror(msg); exit(EXIT_FAILURE); } while (0)
+
+// Reads one IO map entry in place: the field definitions are small and go
+// to the heap, their dimension lists stay in the image
+static const u32 *readIOFieldDefs(const u32 *pu32, const u32 *end, IOFieldDefPair &p) {
+  if (pu32 >= end) throw std::runtime_error("Truncated circuit image\n");
+  p.len = *pu32++;
+  p.defs = (IOFieldDef*)calloc(p.len, sizeof(IOFieldDef));
+  for (u32 j = 0; j < p.len; j++) {
+    if (end - pu32 < 2 || (u64)(end - pu32) < 4 + (u64)pu32[1]) {
+      throw std::runtime_error("Truncated circuit image\n");
+    }
+    p.defs[j].offset = pu32[0];
+    p.defs[j].len = pu32[1];
+    p.defs[j].lengths = pu32 + 2;
+    pu32 += p.defs[j].len + 2;
+    p.defs[j].size = pu32[0];
+    p.defs[j].busId = pu32[1];
+    pu32 += 2;
+  }
+  return pu32;
+}
+
+Circom_Circuit* loadCircuitImage(const u8 *image, size_t size) {
+  u64 hashMapSize = (u64)get_size_of_input_hashmap()*sizeof(HashSignalInfo);
+  u64 witnessSize = (u64)get_size_of_witness()*sizeof(u64);
+  u64 constantsSize = (u64)get_size_of_constants()*sizeof(FrTaggedElement);
+  u64 ioIndexSize = (u64)get_size_of_io_map()*sizeof(u32);
+  u64 ioStart = hashMapSize + witnessSize + constantsSize;
+  if (size < ioStart + ioIndexSize) {
+    throw std::runtime_error("Truncated circuit image\n");
+  }
+
+  Circom_Circuit *circuit = new Circom_Circuit;
+  circuit->image = image;
+  circuit->imageSize = size;
+  circuit->InputHashMap = (const HashSignalInfo *)image;
+  circuit->witness2SignalList = (const u64 *)(image + hashMapSize);
+  for (u32 i = 0; i < get_size_of_witness(); i++) {
+    u64 signal = circuit->witness2SignalList[i];
+    if (signal >= get_total_signal_no()) {
+      throw std::runtime_error("Witness signal out of range in the circuit image\n");
+    }
+    std::vector<Circom_WitnessRun> &runs = circuit->witnessRuns;
+    if (runs.empty() || runs.back().signal + runs.back().n != signal) {
+      Circom_WitnessRun run = { i, (u32)signal, 0 };
+      runs.push_back(run);
+    }
+    runs.back().n++;
+  }
+#ifdef FR_MONTGOMERY_ONLY
+  // the stored constants are tagged: converted once, shared by all contexts
+  const FrTaggedElement *stored = (const FrTaggedElement *)(image + hashMapSize + witnessSize);
+  circuit->circuitConstants = new FrElement[get_size_of_constants()];
+  for (uint i = 0; i < get_size_of_constants(); i++) {
+    Fr_fromTagged(&circuit->circuitConstants[i], &stored[i]);
+  }
+#else
+  circuit->circuitConstants = (FrElement *)(image + hashMapSize + witnessSize);
+#endif
+  circuit->busInsId2FieldInfo = NULL;
+  circuit->tape = NULL;
+
+  if (get_size_of_io_map()>0) {
+    assert(ioStart % sizeof(u32) == 0);
+    const u32 *index = (const u32 *)(image + ioStart);
+    const u32 *pu32 = index + get_size_of_io_map();
+    const u32 *end = (const u32 *)(image + size - size % sizeof(u32));
+    for (uint i = 0; i < get_size_of_io_map(); i++) {
+      pu32 = readIOFieldDefs(pu32, end, circuit->templateInsId2IOSignalInfo[index[i]]);
+    }
+    circuit->busInsId2FieldInfo = (IOFieldDefPair*)calloc(get_size_of_bus_field_map(), sizeof(IOFieldDefPair));
+    for (uint i = 0; i < get_size_of_bus_field_map(); i++) {
+      pu32 = readIOFieldDefs(pu32, end, circuit->busInsId2FieldInfo[i]);
+    }
+  }
+  return circuit;
+}
+
+// The mapping is shared and never released: every context uses it in place
+// and processes running the same circuit share its pages
+Circom_Circuit* loadCircuit(std::string const &datFileName) {
+    int fd;
+    struct stat sb;
+
+    fd = open(datFileName.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cout << ".dat file not found: " << datFileName << "\n";
+        throw std::system_error(errno, std::generic_category(), "open");
+    }
+    
+    if (fstat(fd, &sb) == -1) {          /* To obtain file size */
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat");
+    }
+
+    void *bdata = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (bdata == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    madvise(bdata, sb.st_size, MADV_WILLNEED);
+
+    return loadCircuitImage((const u8 *)bdata, sb.st_size);
+}
+
+bool check_valid_number(std::string & s, uint base){
+  bool is_valid = true;
+  if (base == 16){
+    for (uint i = 0; i < s.size(); i++){
+      is_valid &= (
+        ('0' <= s[i] && s[i] <= '9') || 
+        ('a' <= s[i] && s[i] <= 'f') ||
+        ('A' <= s[i] && s[i] <= 'F')
+      );
+    }
+  } else{
+    for (uint i = 0; i < s.size(); i++){
+      is_valid &= ('0' <= s[i] && s[i] < char(int('0') + base));
+    }
+  }
+  return is_valid;
+}
+
+void json2FrElements (json val, std::vector<FrElement> & vval){
+  if (!val.is_array()) {
+    FrElement v;
+    std::string s_aux, s;
+    uint base;
+    if (val.is_string()) {
+      s_aux = val.get<std::string>();
+      std::string possible_prefix = s_aux.substr(0, 2);
+      if (possible_prefix == "0b" || possible_prefix == "0B"){
+        s = s_aux.substr(2, s_aux.size() - 2);
+        base = 2; 
+      } else if (possible_prefix == "0o" || possible_prefix == "0O"){
+        s = s_aux.substr(2, s_aux.size() - 2);
+        base = 8; 
+      } else if (possible_prefix == "0x" || possible_prefix == "0X"){
+        s = s_aux.substr(2, s_aux.size() - 2);
+        base = 16;
+      } else{
+        s = s_aux;
+        base = 10;
+      }
+      if (!check_valid_number(s, base)){
+        std::ostringstream errStrStream;
+        errStrStream << "Invalid number in JSON input: " << s_aux << "\n";
+	      throw std::runtime_error(errStrStream.str() );
+      }
+    } else if (val.is_number()) {
+        double vd = val.get<double>();
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(0) << vd;
+        s = stream.str();
+        base = 10;
+    } else {
+        std::ostringstream errStrStream;
+        errStrStream << "Invalid JSON type\n";
+	      throw std::runtime_error(errStrStream.str() );
+    }
+    Fr_str2element (&v, s.c_str(), base);
+    vval.push_back(v);
+  } else {
+    for (uint i = 0; i < val.size(); i++) {
+      json2FrElements (val[i], vval);
+    }
+  }
+}
+
+json::value_t check_type(std::string prefix, json in){
+  if (not in.is_array()) {
+    if (in.is_number_integer() || in.is_number_unsigned() || in.is_string())
+      return json::value_t::number_integer;
+    else  return in.type();
+    } else {
+    if (in.size() == 0) return json::value_t::null;
+    json::value_t t = check_type(prefix, in[0]);
+    for (uint i = 1; i < in.size(); i++) {
+      if (t != check_type(prefix, in[i])) {
+	std::ostringstream errStrStream;
+	errStrStream << "Types are not the same in the key " << prefix << "\n";
+	throw std::runtime_error(errStrStream.str() );
+      }
+    }
+    return t;
+  }
+}
+
+void qualify_input(std::string prefix, json &in, json &in1);
+
+void qualify_input_list(std::string prefix, json &in, json &in1){
+    if (in.is_array()) {
+      for (uint i = 0; i<in.size(); i++) {
+	  std::string new_prefix = prefix + "[" + std::to_string(i) + "]";
+	  qualify_input_list(new_prefix,in[i],in1);
+	}
+    } else {
+	qualify_input(prefix,in,in1);
+    }
+}
+
+void qualify_input(std::string prefix, json &in, json &in1) {
+  if (in.is_array()) {
+    if (in.size() > 0) {
+      json::value_t t = check_type(prefix,in);
+      if (t == json::value_t::object) {
+	qualify_input_list(prefix,in,in1);
+      } else {
+	in1[prefix] = in;
+      }
+    } else {
+      in1[prefix] = in;
+    }
+  } else if (in.is_object()) {
+    for (json::iterator it = in.begin(); it != in.end(); ++it) {
+      std::string new_prefix = prefix.length() == 0 ? it.key() : prefix + "." + it.key();
+      qualify_input(new_prefix,it.value(),in1);
+    }
+  } else {
+    in1[prefix] = in;
+  }
+}
+
+void parseJson(json &jin, CircomInputs &inputs) {
+  json j;
+
+  //std::cout << jin << std::endl;
+  std::string prefix = "";
+  qualify_input(prefix, jin, j);
+  //std::cout << j << std::endl;
+
+  inputs.clear();
+  inputs.reserve(j.size());
+  for (json::iterator it = j.begin(); it != j.end(); ++it) {
+    // std::cout << it.key() << " => " << it.value() << '\n';
+    inputs.emplace_back();
+    InputSignalValues &in = inputs.back();
+    in.name = it.key();
+    in.h = fnv1a(it.key());
+    json2FrElements(it.value(),in.values);
+  }
+}
+
+void parseJsonFile(std::string filename, CircomInputs &inputs) {
+  std::ifstream inStream(filename);
+  if (!inStream) {
+    throw std::runtime_error("Cannot open " + filename + "\n");
+  }
+  json jin;
+  inStream >> jin;
+  parseJson(jin, inputs);
+}
+
+void parseJsonBuffer(const char *data, size_t size, CircomInputs &inputs) {
+  json jin = json::parse(data, data + size);
+  parseJson(jin, inputs);
+}
+
+void setInputs(Circom_CalcWit *ctx, CircomInputs &inputs) {
+  u64 nItems = inputs.size();
+  // printf("Items : %llu\n",nItems);
+  if (nItems == 0){
+    ctx->tryRunCircuit();
+  }
+  for (InputSignalValues &in : inputs) {
+    std::vector<FrElement> &v = in.values;
+    int idx = get_main_input_index(in.h);
+    if (idx < 0) {
+	std::ostringstream errStrStream;
+	errStrStream << "Error loading signal " << in.name << ": Signal not found\n";
+	throw std::runtime_error(errStrStream.str() );
+    }
+    uint signalSize = get_main_input_defs()[idx].signalsize;
+    if (v.size() < signalSize) {
+	std::ostringstream errStrStream;
+	errStrStream << "Error loading signal " << in.name << ": Not enough values\n";
+	throw std::runtime_error(errStrStream.str() );
+    }
+    if (v.size() > signalSize) {
+	std::ostringstream errStrStream;
+	errStrStream << "Error loading signal " << in.name << ": Too many values\n";
+	throw std::runtime_error(errStrStream.str() );
+    }
+    try {
+      ctx->setInputSignals(idx, v.data(), v.size());
+    } catch (Circom_AssertError &) {
+      // the circuit ran on the inputs given so far and failed: its message as is
+      throw;
+    } catch (std::runtime_error &e) {
+      std::ostringstream errStrStream;
+      errStrStream << "Error setting signal: " << in.name << "\n" << e.what();
+      throw std::runtime_error(errStrStream.str() );
+    }
+  }
+}
+
+void loadJson(Circom_CalcWit *ctx, std::string filename) {
+  CircomInputs inputs;
+  parseJsonFile(filename, inputs);
+  setInputs(ctx, inputs);
+}
+
+void loadJsonBuffer(Circom_CalcWit *ctx, const char *data, size_t size) {
+  CircomInputs inputs;
+  parseJsonBuffer(data, size, inputs);
+  setInputs(ctx, inputs);
+}
+
+MappedFile::MappedFile(std::string const &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::system_error(errno, std::generic_category(), filename);
+  }
+  struct stat sb;
+  if (fstat(fd, &sb) == -1) {
+    int err = errno;
+    close(fd);
+    throw std::system_error(err, std::generic_category(), filename);
+  }
+  size = sb.st_size;
+  data = NULL;
+  if (size > 0) {
+    void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      int err = errno;
+      close(fd);
+      throw std::system_error(err, std::generic_category(), filename);
+    }
+    data = (const u8 *)p;
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data != NULL) munmap((void *)data, size);
+}
+
+bool isBinInput(const void *data, size_t size) {
+  return size >= 4 && memcmp(data, "cinp", 4) == 0;
+}
+
+const u8 *binInputValues(const void *data, size_t size, u32 &nValues) {
+  const u8 *p = (const u8 *)data;
+  u32 n8 = Fr_N64*8;
+  if (size < BIN_INPUT_HEADER_SIZE || !isBinInput(data, size)) {
+    throw std::runtime_error("Invalid binary input header\n");
+  }
+  u32 version, fileN8;
+  memcpy(&version, p + 4, 4);
+  memcpy(&fileN8, p + 8, 4);
+  if (version != BIN_INPUT_VERSION || fileN8 != n8 || memcmp(p + 12, Fr_rawq, n8) != 0) {
+    throw std::runtime_error("Binary input is for a different version or field\n");
+  }
+  memcpy(&nValues, p + 12 + n8, 4);
+  if (size != BIN_INPUT_HEADER_SIZE + (u64)nValues*n8) {
+    throw std::runtime_error("Binary input size does not match its header\n");
+  }
+  return p + BIN_INPUT_HEADER_SIZE;
+}
+
+void loadBinInputBuffer(Circom_CalcWit *ctx, const void *data, size_t size) {
+  u32 nValues;
+  const u8 *values = binInputValues(data, size, nValues);
+  ctx->setAllInputSignalsLE(values, nValues);
+}
+
+void loadBinInput(Circom_CalcWit *ctx, std::string filename) {
+  MappedFile f(filename);
+  loadBinInputBuffer(ctx, f.data, f.size);
+}
+
+void loadInput(Circom_CalcWit *ctx, std::string filename) {
+  MappedFile f(filename);
+  if (isBinInput(f.data, f.size)) {
+    loadBinInputBuffer(ctx, f.data, f.size);
+  } else {
+    loadJsonBuffer(ctx, (const char *)f.data, f.size);
+  }
+}
+
+void buildBinInput(CircomInputs const &inputs, std::vector<u8> &buf) {
+  u32 n8 = Fr_N64*8;
+  u32 nValues = get_main_input_signal_no();
+  buf.assign(BIN_INPUT_HEADER_SIZE + (size_t)nValues*n8, 0);
+  std::vector<bool> assigned(nValues, false);
+  u32 version = BIN_INPUT_VERSION;
+  memcpy(&buf[0], "cinp", 4);
+  memcpy(&buf[4], &version, 4);
+  memcpy(&buf[8], &n8, 4);
+  memcpy(&buf[12], Fr_rawq, n8);
+  memcpy(&buf[12 + n8], &nValues, 4);
+  for (InputSignalValues const &in : inputs) {
+    int idx = get_main_input_index(in.h);
+    if (idx < 0 || in.values.size() != get_main_input_defs()[idx].signalsize) {
+      std::ostringstream errStrStream;
+      errStrStream << "Error loading signal " << in.name << ": " << (idx < 0 ? "Signal not found" : "Wrong number of values") << "\n";
+      throw std::runtime_error(errStrStream.str() );
+    }
+    uint first = get_main_input_defs()[idx].signalid - get_main_input_signal_start();
+    for (uint i = 0; i < in.values.size(); i++) {
+      FrRawElement v;
+      FrElement e = in.values[i];
+      Fr_toRawNormal(v, &e);
+      memcpy(&buf[BIN_INPUT_HEADER_SIZE + (size_t)(first + i)*n8], v, n8);
+      assigned[first + i] = true;
+    }
+  }
+  for (u32 i = 0; i < nValues; i++) {
+    if (!assigned[i]) {
+      throw std::runtime_error("Not all inputs have been set\n");
+    }
+  }
+}
+
+void writeBinInput(CircomInputs &inputs, std::string filename) {
+  std::vector<u8> buf;
+  buildBinInput(inputs, buf);
+  FILE *write_ptr = fopen(filename.c_str(), "wb");
+  if (write_ptr == NULL) {
+    throw std::system_error(errno, std::generic_category(), filename);
+  }
+  size_t written = fwrite(buf.data(), 1, buf.size(), write_ptr);
+  if (fclose(write_ptr) != 0 || written != buf.size()) {
+    throw std::system_error(errno, std::generic_category(), filename);
+  }
+}
+
+u64 getBinWitnessSize() {
+  u64 n8 = Fr_N64*8;
+  return 12 + (20 + n8) + 12 + n8*(u64)get_size_of_witness();
+}
+
+struct WitnessImageJob {
+  Circom_CalcWit *ctx;
+  u8 *values;  // start of the data section
+  uint nValues;
+  bool montgomery;
+};
+
+// Converts one slice of witness values straight into the image, walking
+// the signals run by run so that both sides are read and written in order
+static void convertWitnessSlice(void *arg, uint slice) {
+  WitnessImageJob *job = (WitnessImageJob *)arg;
+  const std::vector<Circom_WitnessRun> &runs = job->ctx->getWitnessRuns();
+  uint n8 = Fr_N64*8;
+  uint begin = slice*WITNESS_SLICE_SIZE;
+  uint end = std::min(job->nValues, begin + WITNESS_SLICE_SIZE);
+  auto run = std::upper_bound(runs.begin(), runs.end(), begin,
+    [](uint i, const Circom_WitnessRun &r) { return i < r.witness; }) - 1;
+  FrRawElement v;
+  for (uint i = begin; i < end; run++) {
+    uint n = std::min(end, run->witness + run->n) - i;
+    FrElement *e = &job->ctx->signalValues[run->signal + (i - run->witness)];
+    u8 *out = job->values + (u64)i*n8;
+#ifdef FR_MONTGOMERY_ONLY
+    // the elements are the Montgomery limbs, nothing else
+    if (job->montgomery && sizeof(FrElement) == n8) {
+      memcpy(out, e, (size_t)n*n8);
+      i += n;
+      continue;
+    }
+#endif
+    for (uint j = 0; j < n; j++, e++, out += n8) {
+      if (job->montgomery) {
+        Fr_toRawMontgomery(v, e);
+      } else {
+        Fr_toRawNormal(v, e);
+      }
+      memcpy(out, v, n8);
+    }
+    i += n;
+  }
+}
+
+void buildBinWitness(Circom_CalcWit *ctx, u8 *image, bool montgomery) {
+  u8 *p = image;
+  auto put = [&p](const void *data, size_t size) {
+    memcpy(p, data, size);
+    p += size;
+  };
+  u32 version = 2;
+  u32 nSections = 2;
+  u32 n8 = Fr_N64*8;
+  u32 nVars = get_size_of_witness();
+
+  put("wtns", 4);
+  put(&version, 4);
+  put(&nSections, 4);
+
+  // Header
+  u32 idSection1 = 1;
+  u64 idSection1length = 8 + n8;
+  put(&idSection1, 4);
+  put(&idSection1length, 8);
+  put(&n8, 4);
+  put(Fr_rawq, n8);
+  put(&nVars, 4);
+
+  // Data
+  u32 idSection2 = 2;
+  u64 idSection2length = (u64)n8*(u64)nVars;
+  put(&idSection2, 4);
+  put(&idSection2length, 8);
+
+  WitnessImageJob job = { ctx, p, nVars, montgomery };
+  uint nSlices = (nVars + WITNESS_SLICE_SIZE - 1) / WITNESS_SLICE_SIZE;
+  if (ctx->taskPool == NULL) {
+    for (uint s = 0; s < nSlices; s++) {
+      convertWitnessSlice(&job, s);
+    }
+    return;
+  }
+  Circom_TaskGroup slices;
+  for (uint s = 1; s < nSlices; s++) {
+    ctx->taskPool->submit(convertWitnessSlice, &job, s, &slices);
+  }
+  convertWitnessSlice(&job, 0);
+  ctx->taskPool->wait(&slices);
+}
+
+void writeBinWitness(Circom_CalcWit *ctx, FILE *write_ptr, bool montgomery) {
+  // reused across calls so that a server does not allocate per witness
+  static thread_local std::vector<u8> image;
+  image.resize(getBinWitnessSize());
+  buildBinWitness(ctx, image.data(), montgomery);
+  fwrite(image.data(), 1, image.size(), write_ptr);
+}
+
+void writeBinWitness(Circom_CalcWit *ctx, std::string wtnsFileName, bool montgomery) {
+  u64 size = getBinWitnessSize();
+  int fd = open(wtnsFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1) {
+    throw std::system_error(errno, std::generic_category(), wtnsFileName);
+  }
+  if (ftruncate(fd, size) == -1) {
+    int err = errno;
+    close(fd);
+    throw std::system_error(err, std::generic_category(), wtnsFileName);
+  }
+  void *image = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (image == MAP_FAILED) {
+    int err = errno;
+    close(fd);
+    throw std::system_error(err, std::generic_category(), wtnsFileName);
+  }
+  buildBinWitness(ctx, (u8 *)image, montgomery);
+  munmap(image, size);
+  if (close(fd) != 0) {
+    throw std::system_error(errno, std::generic_category(), wtnsFileName);
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef CIRCOM_WITNESS_IO_H
+#define CIRCOM_WITNESS_IO_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "calcwit.hpp"
+#include "circom.hpp"
+
+// Reading inputs and writing .wtns files, shared by the command line
+// front end and the witness server.
+
+// The circuit image is used in place, never copied: loadCircuit maps the
+// .dat file read only, loadCircuitImage takes an image already in memory
+// (linked into the binary, say) that must outlive the circuit.
+Circom_Circuit* loadCircuit(std::string const &datFileName);
+Circom_Circuit* loadCircuitImage(const u8 *image, size_t size);
+
+// Values of one input signal of a witness, as read from its JSON file
+struct InputSignalValues {
+  std::string name;
+  u64 h;
+  std::vector<FrElement> values;
+};
+typedef std::vector<InputSignalValues> CircomInputs;
+
+// Errors in the input (unknown signal, wrong number of values, malformed
+// numbers or JSON) are reported by throwing std::exception.
+// Parsing does not need a context, so it can run apart from the
+// computation; setInputs assigns the values and thereby runs the circuit.
+void parseJsonFile(std::string filename, CircomInputs &inputs);
+void parseJsonBuffer(const char *data, size_t size, CircomInputs &inputs);
+void setInputs(Circom_CalcWit *ctx, CircomInputs &inputs);
+
+void loadJson(Circom_CalcWit *ctx, std::string filename);
+void loadJsonBuffer(Circom_CalcWit *ctx, const char *data, size_t size);
+
+// Binary input format: the main inputs as canonical little endian field
+// elements of n8 bytes, in signal order, after a fixed header
+//
+//   "cinp" | u32 version | u32 n8 | q (n8 bytes) | u32 number of values
+//
+// It is mapped and copied straight into the signals, with no text parsing.
+#define BIN_INPUT_VERSION 1
+#define BIN_INPUT_HEADER_SIZE (4 + 4 + 4 + Fr_N64*8 + 4)
+
+bool isBinInput(const void *data, size_t size);
+// The nValues values that follow a valid header; throws std::runtime_error
+// for a header that is not
+const u8 *binInputValues(const void *data, size_t size, u32 &nValues);
+void loadBinInputBuffer(Circom_CalcWit *ctx, const void *data, size_t size);
+void loadBinInput(Circom_CalcWit *ctx, std::string filename);
+// The binary input of parsed inputs, which must set every main input
+void buildBinInput(CircomInputs const &inputs, std::vector<u8> &buf);
+void writeBinInput(CircomInputs &inputs, std::string filename);
+
+// Loads an input file in either format, told apart by its first bytes
+void loadInput(Circom_CalcWit *ctx, std::string filename);
+
+// Read only mapping of a whole file
+struct MappedFile {
+  const u8 *data;
+  size_t size;
+
+  MappedFile(std::string const &filename);  // throws std::system_error
+  ~MappedFile();
+};
+
+// .wtns output. The whole image (getBinWitnessSize() bytes) is built in
+// memory and written at once: files are sized up front and filled through a
+// mapping, streams get a single fwrite. Values are converted in slices of
+// WITNESS_SLICE_SIZE, spread over the context's task pool when it has one.
+//
+// montgomery keeps the values in Montgomery form (x*R mod q) instead of the
+// canonical form, for provers that read them that way; plain .wtns readers
+// need the default.
+#define WITNESS_SLICE_SIZE 1024u
+
+u64 getBinWitnessSize();
+void buildBinWitness(Circom_CalcWit *ctx, u8 *image, bool montgomery = false);
+void writeBinWitness(Circom_CalcWit *ctx, FILE *write_ptr, bool montgomery = false);
+void writeBinWitness(Circom_CalcWit *ctx, std::string wtnsFileName, bool montgomery = false);
+
+#endif // CIRCOM_WITNESS_IO_H